@@ -0,0 +1,321 @@
+#include "process_queries.h"
+#include "remove_duplicates.h"
+#include "result_writer.h"
+#include "search_server.h"
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <sstream>
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+struct BenchmarkConfig {
+	size_t document_count = 10'000;
+	size_t query_count = 1'000;
+	size_t vocabulary_size = 50'000;
+	size_t document_words = 40;
+	size_t query_words = 3;
+	double zipf_exponent = 1.0;
+	double duplicate_share = 0.01;
+	uint32_t seed = 42;
+	bool json = false;
+};
+
+struct BenchmarkResult {
+	string name;
+	size_t operations = 0;
+	double seconds = 0;
+	// задержки отдельных операций, нс; пусто для пакетных замеров
+	vector<int64_t> latencies;
+	long peak_rss_kb = 0;
+};
+
+// слова по закону Ципфа: вероятность слова ранга k пропорциональна 1 / k^exponent
+class ZipfGenerator {
+public:
+	ZipfGenerator(size_t vocabulary_size, double exponent)
+	: cumulative_(vocabulary_size) {
+		double sum = 0;
+		for (size_t rank = 0; rank < vocabulary_size; ++rank) {
+			sum += 1.0 / pow(rank + 1.0, exponent);
+			cumulative_[rank] = sum;
+		}
+		for (double& value : cumulative_) {
+			value /= sum;
+		}
+	}
+
+	size_t operator()(mt19937& generator) const {
+		const double value = uniform_real_distribution<>(0, 1)(generator);
+		return min<size_t>(upper_bound(cumulative_.begin(), cumulative_.end(), value) - cumulative_.begin(), cumulative_.size() - 1);
+	}
+
+private:
+	vector<double> cumulative_;
+};
+
+vector<string> GenerateVocabulary(mt19937& generator, size_t word_count) {
+	vector<string> words;
+	words.reserve(word_count);
+	for (size_t i = 0; i < word_count; ++i) {
+		// номер в суффиксе делает слова уникальными
+		string word;
+		const int length = uniform_int_distribution(2, 8)(generator);
+		for (int j = 0; j < length; ++j) {
+			word.push_back(uniform_int_distribution('a', 'z')(generator));
+		}
+		words.push_back(word + to_string(i));
+	}
+	return words;
+}
+
+string GenerateText(mt19937& generator, const vector<string>& vocabulary, const ZipfGenerator& zipf, size_t word_count,
+double minus_probability = 0) {
+	string text;
+	for (size_t i = 0; i < word_count; ++i) {
+		if (!text.empty()) {
+			text.push_back(' ');
+		}
+		if (minus_probability > 0 && uniform_real_distribution<>(0, 1)(generator) < minus_probability) {
+			text.push_back('-');
+		}
+		text += vocabulary[zipf(generator)];
+	}
+	return text;
+}
+
+long GetPeakRssKb() {
+	rusage usage{};
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+int64_t ElapsedNs(Clock::time_point start) {
+	return chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+template <typename Operation>
+BenchmarkResult MeasureEach(const string& name, size_t count, Operation operation) {
+	BenchmarkResult result{name, count, 0, {}, 0};
+	result.latencies.reserve(count);
+	const auto start = Clock::now();
+	for (size_t i = 0; i < count; ++i) {
+		const auto operation_start = Clock::now();
+		operation(i);
+		result.latencies.push_back(ElapsedNs(operation_start));
+	}
+	result.seconds = ElapsedNs(start) * 1e-9;
+	result.peak_rss_kb = GetPeakRssKb();
+	return result;
+}
+
+template <typename Operation>
+BenchmarkResult MeasureBatch(const string& name, size_t operations, Operation operation) {
+	BenchmarkResult result{name, operations, 0, {}, 0};
+	const auto start = Clock::now();
+	operation();
+	result.seconds = ElapsedNs(start) * 1e-9;
+	result.peak_rss_kb = GetPeakRssKb();
+	return result;
+}
+
+int64_t GetPercentile(const vector<int64_t>& sorted_latencies, double percentile) {
+	if (sorted_latencies.empty()) {
+		return 0;
+	}
+	const size_t rank = max<size_t>(ceil(percentile / 100.0 * sorted_latencies.size()), 1);
+	return sorted_latencies[min(rank, sorted_latencies.size()) - 1];
+}
+
+void PrintResult(const BenchmarkConfig& config, BenchmarkResult result) {
+	sort(result.latencies.begin(), result.latencies.end());
+	const double throughput = result.seconds > 0 ? result.operations / result.seconds : 0;
+	const pair<string, double> percentiles[] = {{"p50"s, 50}, {"p90"s, 90}, {"p99"s, 99}, {"p99.9"s, 99.9}};
+	if (config.json) {
+		cout << "{\"benchmark\":\""s << result.name << "\",\"documents\":"s << config.document_count
+			<< ",\"operations\":"s << result.operations << ",\"seconds\":"s << result.seconds
+			<< ",\"ops_per_second\":"s << throughput;
+		if (!result.latencies.empty()) {
+			for (const auto& [label, percentile] : percentiles) {
+				cout << ",\""s << label << "_ns\":"s << GetPercentile(result.latencies, percentile);
+			}
+		}
+		cout << ",\"peak_rss_kb\":"s << result.peak_rss_kb << '}' << endl;
+		return;
+	}
+	cout << left << setw(20) << result.name << right << setw(10) << result.operations
+		<< setw(14) << fixed << setprecision(1) << throughput << " ops/s"s;
+	if (!result.latencies.empty()) {
+		for (const auto& [label, percentile] : percentiles) {
+			cout << "  "s << label << '=' << GetPercentile(result.latencies, percentile) << "ns"s;
+		}
+	}
+	cout << "  rss="s << result.peak_rss_kb << "KB"s << endl;
+}
+
+BenchmarkConfig ParseArguments(int argc, char* argv[]) {
+	BenchmarkConfig config;
+	for (int i = 1; i < argc; ++i) {
+		const string_view argument = argv[i];
+		const auto read_value = [&]() {
+			if (i + 1 >= argc) {
+				throw invalid_argument("Missing value for "s + string(argument));
+			}
+			return stod(argv[++i]);
+		};
+		// число документов, запросов или слов — целое не меньше 1
+		const auto read_count = [&]() {
+			const double value = read_value();
+			if (!(value >= 1) || value != floor(value)) {
+				throw invalid_argument(string(argument) + " must be a positive integer"s);
+			}
+			return static_cast<size_t>(value);
+		};
+		if (argument == "--documents"sv) {
+			config.document_count = read_count();
+		} else if (argument == "--queries"sv) {
+			config.query_count = read_count();
+		} else if (argument == "--vocabulary"sv) {
+			config.vocabulary_size = read_count();
+		} else if (argument == "--zipf"sv) {
+			config.zipf_exponent = read_value();
+			if (!(config.zipf_exponent >= 0)) {
+				throw invalid_argument("--zipf must be non-negative"s);
+			}
+		} else if (argument == "--seed"sv) {
+			const double seed = read_value();
+			if (!(seed >= 0) || seed > numeric_limits<uint32_t>::max() || seed != floor(seed)) {
+				throw invalid_argument("--seed must be a 32-bit unsigned integer"s);
+			}
+			config.seed = static_cast<uint32_t>(seed);
+		} else if (argument == "--small"sv) {
+			config.document_count = 10'000;
+		} else if (argument == "--medium"sv) {
+			config.document_count = 1'000'000;
+		} else if (argument == "--large"sv) {
+			config.document_count = 10'000'000;
+		} else if (argument == "--json"sv) {
+			config.json = true;
+		} else {
+			throw invalid_argument("Unknown argument "s + string(argument));
+		}
+	}
+	return config;
+}
+
+void RunBenchmarks(const BenchmarkConfig& config) {
+	mt19937 generator(config.seed);
+	const vector<string> vocabulary = GenerateVocabulary(generator, config.vocabulary_size);
+	const ZipfGenerator zipf(config.vocabulary_size, config.zipf_exponent);
+
+	vector<string> queries;
+	queries.reserve(config.query_count);
+	for (size_t i = 0; i < config.query_count; ++i) {
+		queries.push_back(GenerateText(generator, vocabulary, zipf, config.query_words, 0.1));
+	}
+
+	if (config.json) {
+		cout << "{\"config\":{\"documents\":"s << config.document_count << ",\"queries\":"s << config.query_count
+			<< ",\"vocabulary\":"s << config.vocabulary_size << ",\"zipf\":"s << config.zipf_exponent
+			<< ",\"seed\":"s << config.seed << "}}"s << endl;
+	}
+
+	SearchServer search_server("and with"s);
+	// тексты документов не хранятся целиком и генерируются вне замера; дубликат — копия предыдущего
+	BenchmarkResult add_document{"add_document"s, config.document_count, 0, {}, 0};
+	add_document.latencies.reserve(config.document_count);
+	string document;
+	for (size_t i = 0; i < config.document_count; ++i) {
+		if (i == 0 || uniform_real_distribution<>(0, 1)(generator) >= config.duplicate_share) {
+			document = GenerateText(generator, vocabulary, zipf, config.document_words);
+		}
+		const auto start = Clock::now();
+		search_server.AddDocument(i, document, DocumentStatus::ACTUAL, {1, 2, 3});
+		add_document.latencies.push_back(ElapsedNs(start));
+	}
+	add_document.seconds = accumulate(add_document.latencies.begin(), add_document.latencies.end(), int64_t{0}) * 1e-9;
+	add_document.peak_rss_kb = GetPeakRssKb();
+	PrintResult(config, add_document);
+
+	PrintResult(config, MeasureEach("find_top_seq"s, queries.size(), [&](size_t i) {
+		search_server.FindTopDocuments(execution::seq, queries[i]);
+	}));
+	PrintResult(config, MeasureEach("find_top_par"s, queries.size(), [&](size_t i) {
+		search_server.FindTopDocuments(execution::par, queries[i]);
+	}));
+
+	vector<int> document_ids(config.query_count);
+	for (int& document_id : document_ids) {
+		document_id = uniform_int_distribution<int>(0, config.document_count - 1)(generator);
+	}
+	PrintResult(config, MeasureEach("match_document"s, queries.size(), [&](size_t i) {
+		search_server.MatchDocument(queries[i], document_ids[i]);
+	}));
+	PrintResult(config, MeasureEach("match_document_par"s, queries.size(), [&](size_t i) {
+		search_server.MatchDocument(execution::par, queries[i], document_ids[i]);
+	}));
+	PrintResult(config, MeasureBatch("process_queries"s, queries.size(), [&] {
+		ProcessQueries(search_server, queries);
+	}));
+
+	// вывод результатов в /dev/null: потоки с endl против ResultWriter
+	const vector<Document> joined_documents = ProcessQueriesJoined(search_server, queries);
+	PrintResult(config, MeasureBatch("write_ostream"s, joined_documents.size(), [&] {
+		ofstream output("/dev/null"s);
+		for (const Document& document : joined_documents) {
+			output << document << endl;
+		}
+	}));
+	const int null_fd = open("/dev/null", O_WRONLY);
+	const pair<string, ResultFormat> formats[] = {{"write_text"s, ResultFormat::TEXT}, {"write_json"s, ResultFormat::JSON},
+		{"write_binary"s, ResultFormat::BINARY}};
+	for (const auto& [name, format] : formats) {
+		PrintResult(config, MeasureBatch(name, joined_documents.size(), [&, format = format] {
+			ResultWriter writer(null_fd, format);
+			writer.Write(joined_documents);
+			writer.Flush();
+		}));
+	}
+	close(null_fd);
+
+	// RemoveDuplicates печатает найденные id, в замер они не попадают
+	ostringstream removed_output;
+	streambuf* const cout_buffer = cout.rdbuf(removed_output.rdbuf());
+	const BenchmarkResult remove_duplicates = MeasureBatch("remove_duplicates"s, config.document_count, [&] {
+		RemoveDuplicates(search_server);
+	});
+	cout.rdbuf(cout_buffer);
+	PrintResult(config, remove_duplicates);
+
+	vector<int> remaining_ids(search_server.begin(), search_server.end());
+	shuffle(remaining_ids.begin(), remaining_ids.end(), generator);
+	remaining_ids.resize(min(remaining_ids.size(), config.query_count));
+	PrintResult(config, MeasureEach("remove_document"s, remaining_ids.size(), [&](size_t i) {
+		search_server.RemoveDocument(remaining_ids[i]);
+	}));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+	try {
+		RunBenchmarks(ParseArguments(argc, argv));
+	} catch (const exception& e) {
+		cerr << "benchmark: "s << e.what() << endl;
+		cerr << "usage: benchmark [--small|--medium|--large] [--documents N] [--queries N] [--vocabulary N] [--zipf S] [--seed N] [--json]"s << endl;
+		return 1;
+	}
+}
@@ -0,0 +1,339 @@
+#include "bulk_ingest.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <charconv>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace {
+
+struct ParsedDocument {
+	// номер строки в блоке, с 1
+	size_t line = 0;
+	std::optional<int> id;
+	DocumentStatus status = DocumentStatus::ACTUAL;
+	std::vector<int> ratings;
+	std::vector<std::string_view> words;
+};
+
+struct Block {
+	size_t index = 0;
+	// целое число строк; string_view разобранных документов указывают сюда
+	std::string data;
+	std::vector<ParsedDocument> documents;
+	size_t line_count = 0;
+	// первая ошибка разбора: номер строки в блоке и текст
+	std::optional<std::pair<size_t, std::string>> error;
+};
+
+DocumentStatus ParseStatus(std::string_view text) {
+	if (text == "ACTUAL") {
+		return DocumentStatus::ACTUAL;
+	}
+	if (text == "IRRELEVANT") {
+		return DocumentStatus::IRRELEVANT;
+	}
+	if (text == "BANNED") {
+		return DocumentStatus::BANNED;
+	}
+	if (text == "REMOVED") {
+		return DocumentStatus::REMOVED;
+	}
+	throw std::invalid_argument("Invalid status "s + std::string(text));
+}
+
+int ParseInt(std::string_view text) {
+	int value = 0;
+	const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+	if (error != std::errc() || end != text.data() + text.size()) {
+		throw std::invalid_argument("Invalid number "s + std::string(text));
+	}
+	return value;
+}
+
+// отрезает от text поле до табуляции
+std::string_view TakeField(std::string_view& text) {
+	const size_t tab = text.find('\t');
+	if (tab == std::string_view::npos) {
+		throw std::invalid_argument("Missing field"s);
+	}
+	const std::string_view field = text.substr(0, tab);
+	text.remove_prefix(tab + 1);
+	return field;
+}
+
+// line указывает в изменяемый блок: при приведении к нижнему регистру текст переписывается на месте
+ParsedDocument ParseLine(const SearchServer& search_server, std::string_view line, char* line_data) {
+	ParsedDocument document;
+	const char* const line_begin = line.data();
+	if (line.find('\t') != std::string_view::npos) {
+		document.id = ParseInt(TakeField(line));
+		document.status = ParseStatus(TakeField(line));
+		std::string_view ratings = TakeField(line);
+		while (!ratings.empty()) {
+			const size_t comma = std::min(ratings.find(','), ratings.size());
+			document.ratings.push_back(ParseInt(ratings.substr(0, comma)));
+			ratings.remove_prefix(std::min(comma + 1, ratings.size()));
+		}
+	}
+	document.words = search_server.SplitIntoWordsNoStop(line,
+		search_server.IsAsciiCaseFolding() ? line_data + (line.data() - line_begin) : nullptr);
+	return document;
+}
+
+void ParseBlock(const SearchServer& search_server, Block& block) {
+	std::string_view text = block.data;
+	while (!text.empty()) {
+		const size_t line_end = std::min(text.find('\n'), text.size());
+		std::string_view line = text.substr(0, line_end);
+		text.remove_prefix(std::min(line_end + 1, text.size()));
+		++block.line_count;
+		if (!line.empty() && line.back() == '\r') {
+			line.remove_suffix(1);
+		}
+		if (line.empty()) {
+			continue;
+		}
+		try {
+			block.documents.push_back(ParseLine(search_server, line, block.data.data() + (line.data() - block.data.data())));
+			block.documents.back().line = block.line_count;
+		} catch (const std::invalid_argument& e) {
+			block.error = {block.line_count, e.what()};
+			return;
+		}
+	}
+}
+
+// Конвейер: поток чтения режет вход на блоки по границам строк, рабочие потоки разбирают блоки,
+// вызывающий поток забирает готовые блоки по порядку и вставляет документы в индекс
+class IngestPipeline {
+public:
+	IngestPipeline(const SearchServer& search_server, int fd, size_t queue_capacity)
+	: search_server_(search_server)
+	, fd_(fd)
+	, queue_capacity_(std::max<size_t>(queue_capacity, 1)) {
+		if (pipe(cancel_pipe_) != 0) {
+			throw std::runtime_error("Cannot create pipe: "s + std::strerror(errno));
+		}
+		const size_t worker_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+		reader_ = std::thread([this] { RunReader(); });
+		for (size_t i = 0; i < worker_count; ++i) {
+			workers_.emplace_back([this] { RunWorker(); });
+		}
+	}
+
+	~IngestPipeline() {
+		{
+			std::lock_guard guard(mutex_);
+			stop_ = true;
+		}
+		changed_.notify_all();
+		// поток чтения может ждать данных из канала или терминала: будим его через cancel_pipe_
+		const char wake = 0;
+		while (write(cancel_pipe_[1], &wake, 1) < 0 && errno == EINTR) {
+		}
+		reader_.join();
+		for (std::thread& worker : workers_) {
+			worker.join();
+		}
+		close(cancel_pipe_[0]);
+		close(cancel_pipe_[1]);
+	}
+
+	// следующий по порядку разобранный блок; пустой указатель — вход закончился
+	std::unique_ptr<Block> Next() {
+		std::unique_lock guard(mutex_);
+		changed_.wait(guard, [this] {
+			return reader_error_ || parsed_.count(next_index_) || (reader_done_ && next_index_ == block_count_);
+		});
+		if (reader_error_) {
+			std::rethrow_exception(reader_error_);
+		}
+		const auto it = parsed_.find(next_index_);
+		if (it == parsed_.end()) {
+			return nullptr;
+		}
+		std::unique_ptr<Block> block = std::move(it->second);
+		parsed_.erase(it);
+		++next_index_;
+		return block;
+	}
+
+	// блок вставлен, его место в конвейере свободно
+	void Release() {
+		{
+			std::lock_guard guard(mutex_);
+			--in_flight_;
+		}
+		changed_.notify_all();
+	}
+
+private:
+	const SearchServer& search_server_;
+	const int fd_;
+	const size_t queue_capacity_;
+	// запись в cancel_pipe_[1] прерывает ожидание входа
+	int cancel_pipe_[2];
+
+	std::mutex mutex_;
+	std::condition_variable changed_;
+	std::deque<std::unique_ptr<Block>> pending_;
+	std::map<size_t, std::unique_ptr<Block>> parsed_;
+	size_t in_flight_ = 0;
+	size_t block_count_ = 0;
+	size_t next_index_ = 0;
+	bool reader_done_ = false;
+	bool stop_ = false;
+	std::exception_ptr reader_error_;
+
+	std::thread reader_;
+	std::vector<std::thread> workers_;
+
+	void RunReader() {
+		std::string carry;
+		try {
+			while (true) {
+				{
+					std::unique_lock guard(mutex_);
+					changed_.wait(guard, [this] {
+						return stop_ || in_flight_ < queue_capacity_;
+					});
+					if (stop_) {
+						break;
+					}
+				}
+				auto block = std::make_unique<Block>();
+				block->data = std::move(carry);
+				carry.clear();
+				const size_t old_size = block->data.size();
+				block->data.resize(old_size + INGEST_BLOCK_SIZE);
+				if (!WaitInput()) {
+					break;
+				}
+				ssize_t read_size = 0;
+				do {
+					read_size = read(fd_, block->data.data() + old_size, INGEST_BLOCK_SIZE);
+				} while (read_size < 0 && errno == EINTR);
+				if (read_size < 0) {
+					throw std::runtime_error("Read error: "s + std::strerror(errno));
+				}
+				block->data.resize(old_size + read_size);
+				const bool is_last = read_size == 0;
+				if (!is_last) {
+					// хвост без перевода строки уходит в следующий блок
+					const size_t line_end = block->data.rfind('\n');
+					const size_t cut = line_end == std::string::npos ? 0 : line_end + 1;
+					carry.assign(block->data, cut, std::string::npos);
+					block->data.resize(cut);
+				}
+				std::lock_guard guard(mutex_);
+				if (!block->data.empty()) {
+					block->index = block_count_++;
+					++in_flight_;
+					pending_.push_back(std::move(block));
+				}
+				if (is_last) {
+					reader_done_ = true;
+				}
+				changed_.notify_all();
+				if (is_last) {
+					break;
+				}
+			}
+		} catch (...) {
+			std::lock_guard guard(mutex_);
+			reader_error_ = std::current_exception();
+			reader_done_ = true;
+		}
+		changed_.notify_all();
+	}
+
+	// false — загрузку остановили, пока вход был пуст
+	bool WaitInput() {
+		pollfd fds[2] = {{fd_, POLLIN, 0}, {cancel_pipe_[0], POLLIN, 0}};
+		while (poll(fds, 2, -1) < 0) {
+			if (errno != EINTR) {
+				throw std::runtime_error("Poll error: "s + std::strerror(errno));
+			}
+		}
+		return (fds[1].revents & POLLIN) == 0;
+	}
+
+	void RunWorker() {
+		while (true) {
+			std::unique_ptr<Block> block;
+			{
+				std::unique_lock guard(mutex_);
+				changed_.wait(guard, [this] {
+					return stop_ || !pending_.empty() || reader_done_;
+				});
+				if (pending_.empty()) {
+					if (stop_ || reader_done_) {
+						return;
+					}
+					continue;
+				}
+				block = std::move(pending_.front());
+				pending_.pop_front();
+			}
+			ParseBlock(search_server_, *block);
+			{
+				std::lock_guard guard(mutex_);
+				parsed_.emplace(block->index, std::move(block));
+			}
+			changed_.notify_all();
+		}
+	}
+};
+
+} // namespace
+
+size_t IngestDocuments(SearchServer& search_server, int fd, size_t queue_capacity) {
+	IngestPipeline pipeline(search_server, fd, queue_capacity);
+	size_t document_count = 0;
+	size_t line_offset = 0;
+	while (const std::unique_ptr<Block> block = pipeline.Next()) {
+		for (const ParsedDocument& document : block->documents) {
+			const int document_id = document.id.value_or(static_cast<int>(line_offset + document.line - 1));
+			try {
+				search_server.AddDocumentWords(document_id, document.words, document.status, document.ratings);
+			} catch (const std::invalid_argument& e) {
+				throw std::invalid_argument("Document "s + std::to_string(document_id) + ": "s + e.what());
+			}
+			++document_count;
+		}
+		if (block->error) {
+			throw std::invalid_argument("Line "s + std::to_string(line_offset + block->error->first) + ": "s + block->error->second);
+		}
+		line_offset += block->line_count;
+		pipeline.Release();
+	}
+	return document_count;
+}
+
+size_t IngestDocuments(SearchServer& search_server, const std::string& path, size_t queue_capacity) {
+	if (path == "-"s) {
+		return IngestDocuments(search_server, STDIN_FILENO, queue_capacity);
+	}
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::invalid_argument("Cannot open "s + path + ": "s + std::strerror(errno));
+	}
+	try {
+		const size_t document_count = IngestDocuments(search_server, fd, queue_capacity);
+		close(fd);
+		return document_count;
+	} catch (...) {
+		close(fd);
+		throw;
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+#include "search_server.h"
+
+const size_t INGEST_BLOCK_SIZE = 1 << 20;
+const size_t DEFAULT_INGEST_QUEUE_CAPACITY = 16;
+
+// Массовая загрузка документов. Строка — документ: id, статус, оценки через запятую и текст
+// через табуляцию, например "12\tACTUAL\t5,-2,7\tcurly cat curly tail". Строка без табуляции
+// целиком считается текстом документа с номером строки (с 0) в качестве id, статусом ACTUAL и без оценок.
+// Пустые строки пропускаются.
+// Файл читается блоками, разбор и токенизация блоков идут в пуле потоков, вставка в индекс —
+// в вызывающем потоке в порядке файла; в работе не больше queue_capacity блоков.
+// Ошибка формата или AddDocument останавливает загрузку с std::invalid_argument,
+// уже добавленные документы остаются. Возвращает число добавленных документов
+size_t IngestDocuments(SearchServer& search_server, int fd, size_t queue_capacity = DEFAULT_INGEST_QUEUE_CAPACITY);
+// path "-" — стандартный ввод
+size_t IngestDocuments(SearchServer& search_server, const std::string& path, size_t queue_capacity = DEFAULT_INGEST_QUEUE_CAPACITY);
@@ -0,0 +1,37 @@
+#include "levenshtein_automaton.h"
+#include <algorithm>
+
+LevenshteinAutomaton::LevenshteinAutomaton(std::string_view word, int max_distance)
+: word_(word)
+, max_distance_(max_distance) {
+}
+
+size_t LevenshteinAutomaton::RowSize() const {
+	return word_.size() + 1;
+}
+
+void LevenshteinAutomaton::Start(int* row) const {
+	for (size_t i = 0; i < RowSize(); ++i) {
+		row[i] = std::min(static_cast<int>(i), max_distance_ + 1);
+	}
+}
+
+void LevenshteinAutomaton::Step(const int* row, char c, int* next_row) const {
+	next_row[0] = std::min(row[0] + 1, max_distance_ + 1);
+	for (size_t i = 1; i < RowSize(); ++i) {
+		const int cost = word_[i - 1] == c ? 0 : 1;
+		next_row[i] = std::min({row[i] + 1, next_row[i - 1] + 1, row[i - 1] + cost, max_distance_ + 1});
+	}
+}
+
+int LevenshteinAutomaton::GetDistance(const int* row) const {
+	return row[RowSize() - 1];
+}
+
+bool LevenshteinAutomaton::IsMatch(const int* row) const {
+	return row[RowSize() - 1] <= max_distance_;
+}
+
+bool LevenshteinAutomaton::CanMatch(const int* row) const {
+	return *std::min_element(row, row + RowSize()) <= max_distance_;
+}
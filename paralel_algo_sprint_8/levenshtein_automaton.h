@@ -0,0 +1,124 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Автомат Левенштейна для слова word: состояние после прочитанного префикса —
+// строка матрицы редакционных расстояний, значения ограничены max_distance + 1
+class LevenshteinAutomaton {
+public:
+	struct Match {
+		std::string_view term;
+		int distance;
+	};
+
+	LevenshteinAutomaton(std::string_view word, int max_distance);
+
+	// все термины словаря на расстоянии не больше max_distance, прошедшие filter, в лексикографическом порядке.
+	// Словарь — упорядоченный map со строковыми ключами и прозрачным компаратором;
+	// он обходится как неявный префиксный бор, ветки без совпадений пропускаются через lower_bound
+	template <typename SortedDictionary, typename TermFilter>
+	std::vector<Match> Intersect(const SortedDictionary& dictionary, TermFilter filter) const;
+
+private:
+	std::string word_;
+	int max_distance_;
+
+	size_t RowSize() const;
+	void Start(int* row) const;
+	void Step(const int* row, char c, int* next_row) const;
+	// расстояние до слова, если прочитанный префикс — совпадение
+	int GetDistance(const int* row) const;
+	bool IsMatch(const int* row) const;
+	bool CanMatch(const int* row) const;
+
+	template <typename SortedDictionary, typename TermFilter>
+	class Walker;
+};
+
+template <typename SortedDictionary, typename TermFilter>
+class LevenshteinAutomaton::Walker {
+public:
+	using Iterator = typename SortedDictionary::const_iterator;
+
+	Walker(const LevenshteinAutomaton& automaton, const SortedDictionary& dictionary, TermFilter filter)
+	: automaton_(automaton)
+	, dictionary_(dictionary)
+	, filter_(filter)
+	, rows_(automaton.RowSize()) {
+		automaton_.Start(Row(0));
+	}
+
+	std::vector<Match> Run() {
+		Walk(0, dictionary_.begin());
+		return std::move(result_);
+	}
+
+private:
+	const LevenshteinAutomaton& automaton_;
+	const SortedDictionary& dictionary_;
+	TermFilter filter_;
+	// строки матрицы для каждой глубины префикса
+	std::vector<int> rows_;
+	// текущий префикс
+	std::string key_;
+	std::vector<Match> result_;
+
+	int* Row(size_t depth) {
+		const size_t row_size = automaton_.RowSize();
+		if (rows_.size() < (depth + 1) * row_size) {
+			rows_.resize((depth + 1) * row_size);
+		}
+		return rows_.data() + depth * row_size;
+	}
+
+	static bool StartsWith(std::string_view term, std::string_view prefix) {
+		return term.substr(0, prefix.size()) == prefix;
+	}
+
+	// первый термин за поддеревом префикса key_
+	Iterator SkipSubtree(Iterator it) {
+		if (static_cast<unsigned char>(key_.back()) == 0xFF) {
+			while (it != dictionary_.end() && StartsWith(it->first, key_)) {
+				++it;
+			}
+			return it;
+		}
+		++key_.back();
+		return dictionary_.lower_bound(std::string_view(key_));
+	}
+
+	Iterator Walk(size_t depth, Iterator it) {
+		while (it != dictionary_.end()) {
+			const std::string_view term = it->first;
+			if (!StartsWith(term, std::string_view(key_.data(), depth))) {
+				break;
+			}
+			if (term.size() == depth) {
+				if (automaton_.IsMatch(Row(depth)) && filter_(*it)) {
+					result_.push_back({term, automaton_.GetDistance(Row(depth))});
+				}
+				++it;
+				continue;
+			}
+			const char c = term[depth];
+			key_.resize(depth);
+			key_.push_back(c);
+			int* next_row = Row(depth + 1);
+			automaton_.Step(Row(depth), c, next_row);
+			if (automaton_.CanMatch(next_row)) {
+				it = Walk(depth + 1, it);
+			} else {
+				it = SkipSubtree(it);
+			}
+			key_.resize(depth);
+		}
+		return it;
+	}
+};
+
+template <typename SortedDictionary, typename TermFilter>
+std::vector<LevenshteinAutomaton::Match> LevenshteinAutomaton::Intersect(const SortedDictionary& dictionary, TermFilter filter) const {
+	return Walker<SortedDictionary, TermFilter>(*this, dictionary, filter).Run();
+}
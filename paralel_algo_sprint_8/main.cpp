@@ -1,6 +1,5 @@
 // #include "process_queries.h"
 // #include "search_server.h"
-// #include "log_duration.h"
 // #include <execution>
 // #include <iostream>
 // #include <string>
@@ -47,7 +46,7 @@
 // }
 
 #include "search_server.h"
-#include "log_duration.h"
+#include "profiler.h"
 #include <iostream>
 #include <random>
 
@@ -98,8 +97,7 @@ vector<string> GenerateQueries(mt19937& generator, const vector<string>& diction
 }
 
 template <typename ExecutionPolicy>
-void Test(string_view mark, const SearchServer& search_server, const vector<string>& queries, ExecutionPolicy&& policy) {
-    LOG_DURATION(mark);
+void Test(const SearchServer& search_server, const vector<string>& queries, ExecutionPolicy&& policy) {
     double total_relevance = 0;
     for (const string_view query : queries) {
         for (const auto& document : search_server.FindTopDocuments(policy, query)) {
@@ -121,7 +119,14 @@ int main() {
     }
 
     const auto queries = GenerateQueries(generator, dictionary, 100, 70);
-    Test("seq", search_server, queries, execution::seq);
-    Test("par", search_server, queries, execution::par);
+    {
+        PROFILE_SCOPE("seq");
+        Test(search_server, queries, execution::seq);
+    }
+    {
+        PROFILE_SCOPE("par");
+        Test(search_server, queries, execution::par);
+    }
+    PrintFlatProfile(cerr);
 
 }
\ No newline at end of file
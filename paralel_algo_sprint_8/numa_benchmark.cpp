@@ -0,0 +1,108 @@
+#include "numa_placement.h"
+#include "sharded_search_server.h"
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+const size_t BUFFER_SIZE = 64 << 20;
+const int READ_PASSES = 4;
+
+// пропускная способность чтения памяти узла memory_node потоком узла cpu_node, ГБ/с
+double MeasureReadBandwidth(size_t cpu_node, size_t memory_node) {
+	vector<uint64_t> buffer;
+	// первое касание потоком узла memory_node размещает страницы на этом узле
+	NodeThreadPool(memory_node, 1).Submit([&buffer] {
+		buffer.assign(BUFFER_SIZE / sizeof(uint64_t), 1);
+	}).get();
+
+	return NodeThreadPool(cpu_node, 1).Submit([&buffer] {
+		uint64_t checksum = 0;
+		const auto start = Clock::now();
+		for (int pass = 0; pass < READ_PASSES; ++pass) {
+			checksum += accumulate(buffer.begin(), buffer.end(), uint64_t{0});
+		}
+		const chrono::duration<double> elapsed = Clock::now() - start;
+		if (checksum == 0) {
+			cerr << "unexpected checksum"s << endl;
+		}
+		return READ_PASSES * BUFFER_SIZE / elapsed.count() / 1e9;
+	}).get();
+}
+
+string GenerateDocument(mt19937& generator, const vector<string>& dictionary, int word_count) {
+	string document;
+	for (int i = 0; i < word_count; ++i) {
+		if (!document.empty()) {
+			document.push_back(' ');
+		}
+		document += dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)];
+	}
+	return document;
+}
+
+double MeasureQueryThroughput(ShardPlacement placement, size_t shard_count, const vector<string>& documents, const vector<string>& queries) {
+	ShardedSearchServer search_server("and with"s, shard_count, placement);
+	vector<DocumentInput> batch;
+	for (size_t i = 0; i < documents.size(); ++i) {
+		batch.push_back({static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1, 2, 3}});
+	}
+	search_server.AddDocuments(batch);
+
+	const auto start = Clock::now();
+	size_t found = 0;
+	for (const string& query : queries) {
+		found += search_server.FindTopDocuments(query).size();
+	}
+	const chrono::duration<double> elapsed = Clock::now() - start;
+	if (found == 0) {
+		cerr << "no documents found"s << endl;
+	}
+	return queries.size() / elapsed.count();
+}
+
+} // namespace
+
+int main() {
+	const size_t node_count = GetNumaNodeCount();
+	cout << "numa nodes: "s << node_count << endl;
+	for (size_t node = 0; node < node_count; ++node) {
+		NodeThreadPool pool(node, 1);
+		cout << "node "s << GetNumaNodeId(node) << ": "s << GetNumaNodeCpus()[node].size() << " cpus, binding "s
+			<< (pool.IsBound() ? "ok"s : "unavailable"s) << endl;
+	}
+
+	cout << "read bandwidth, GB/s (rows: cpu node, columns: memory node)"s << endl;
+	for (size_t cpu_node = 0; cpu_node < node_count; ++cpu_node) {
+		cout << "cpu "s << cpu_node << ':';
+		for (size_t memory_node = 0; memory_node < node_count; ++memory_node) {
+			cout << ' ' << fixed << setprecision(2) << MeasureReadBandwidth(cpu_node, memory_node);
+		}
+		cout << endl;
+	}
+
+	mt19937 generator;
+	vector<string> dictionary;
+	for (int i = 0; i < 2000; ++i) {
+		dictionary.push_back("w"s + to_string(i));
+	}
+	vector<string> documents;
+	for (int i = 0; i < 20'000; ++i) {
+		documents.push_back(GenerateDocument(generator, dictionary, 50));
+	}
+	vector<string> queries;
+	for (int i = 0; i < 500; ++i) {
+		queries.push_back(GenerateDocument(generator, dictionary, 5));
+	}
+	const size_t shard_count = max<size_t>(node_count * 2, 2);
+	cout << "queries/s, any placement: "s << MeasureQueryThroughput(ShardPlacement::ANY, shard_count, documents, queries) << endl;
+	cout << "queries/s, numa placement: "s << MeasureQueryThroughput(ShardPlacement::NUMA_NODES, shard_count, documents, queries) << endl;
+}
@@ -0,0 +1,195 @@
+#include "numa_placement.h"
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std::string_literals;
+
+namespace {
+
+struct NumaTopology {
+	// номера узлов в ядре
+	std::vector<int> node_ids;
+	std::vector<std::vector<int>> node_cpus;
+};
+
+// список вида "0-3,8-11"
+std::vector<int> ParseIdList(const std::string& text) {
+	std::vector<int> ids;
+	std::istringstream input(text);
+	std::string range;
+	while (std::getline(input, range, ',')) {
+		if (range.empty() || range == "\n") {
+			continue;
+		}
+		const size_t dash = range.find('-');
+		const int first = std::stoi(range.substr(0, dash));
+		const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+		for (int id = first; id <= last; ++id) {
+			ids.push_back(id);
+		}
+	}
+	return ids;
+}
+
+bool ReadIdList(const std::string& path, std::vector<int>& ids) {
+	std::ifstream input(path);
+	std::string list;
+	if (!input || !std::getline(input, list)) {
+		return false;
+	}
+	ids = ParseIdList(list);
+	return true;
+}
+
+NumaTopology ReadNumaTopology() {
+	NumaTopology topology;
+	// номера узлов могут идти с пропусками, например после отключения узла
+	std::vector<int> online_nodes;
+	if (ReadIdList("/sys/devices/system/node/online"s, online_nodes)) {
+		for (const int node : online_nodes) {
+			std::vector<int> cpus;
+			// узел только с памятью процессоров не имеет, потоки на него не привязать
+			if (ReadIdList("/sys/devices/system/node/node"s + std::to_string(node) + "/cpulist"s, cpus) && !cpus.empty()) {
+				topology.node_ids.push_back(node);
+				topology.node_cpus.push_back(std::move(cpus));
+			}
+		}
+	}
+	if (topology.node_cpus.empty()) {
+		std::vector<int> cpus(std::max(std::thread::hardware_concurrency(), 1u));
+		for (size_t cpu = 0; cpu < cpus.size(); ++cpu) {
+			cpus[cpu] = cpu;
+		}
+		topology.node_ids.assign(1, 0);
+		topology.node_cpus.push_back(std::move(cpus));
+	}
+	return topology;
+}
+
+const NumaTopology& GetNumaTopology() {
+	static const NumaTopology topology = ReadNumaTopology();
+	return topology;
+}
+
+bool SetPreferredMemoryNode(int node) {
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+	// MPOL_PREFERRED из <numaif.h>; сам вызов не требует libnuma
+	const int mpol_preferred = 1;
+	const size_t bits_per_word = 8 * sizeof(unsigned long);
+	unsigned long node_mask[16] = {};
+	if (node < 0 || static_cast<size_t>(node) >= bits_per_word * std::size(node_mask)) {
+		return false;
+	}
+	node_mask[node / bits_per_word] |= 1ul << (node % bits_per_word);
+	return syscall(SYS_set_mempolicy, mpol_preferred, node_mask, bits_per_word * std::size(node_mask)) == 0;
+#else
+	(void)node;
+	return false;
+#endif
+}
+
+bool PinCurrentThread(const std::vector<int>& cpus) {
+#if defined(__linux__)
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	for (const int cpu : cpus) {
+		if (cpu < CPU_SETSIZE) {
+			CPU_SET(cpu, &cpu_set);
+		}
+	}
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#else
+	(void)cpus;
+	return false;
+#endif
+}
+
+} // namespace
+
+const std::vector<std::vector<int>>& GetNumaNodeCpus() {
+	return GetNumaTopology().node_cpus;
+}
+
+size_t GetNumaNodeCount() {
+	return GetNumaNodeCpus().size();
+}
+
+int GetNumaNodeId(size_t node) {
+	return GetNumaTopology().node_ids.at(node);
+}
+
+bool BindCurrentThreadToNode(size_t node) {
+	const auto& nodes = GetNumaNodeCpus();
+	if (node >= nodes.size()) {
+		return false;
+	}
+	const bool pinned = PinCurrentThread(nodes[node]);
+	// на машине с одним узлом политика памяти ничего не меняет
+	const bool memory_bound = nodes.size() == 1 || SetPreferredMemoryNode(GetNumaNodeId(node));
+	return pinned && memory_bound;
+}
+
+NodeThreadPool::NodeThreadPool(size_t node, size_t thread_count)
+: node_(node) {
+	for (size_t i = 0; i < std::max<size_t>(thread_count, 1); ++i) {
+		threads_.emplace_back([this] {
+			Run();
+		});
+	}
+	std::unique_lock guard(mutex_);
+	cv_.wait(guard, [this] {
+		return started_count_ == threads_.size();
+	});
+}
+
+NodeThreadPool::~NodeThreadPool() {
+	{
+		std::lock_guard guard(mutex_);
+		stop_ = true;
+	}
+	cv_.notify_all();
+	for (auto& thread : threads_) {
+		thread.join();
+	}
+}
+
+size_t NodeThreadPool::GetNode() const {
+	return node_;
+}
+
+bool NodeThreadPool::IsBound() const {
+	std::lock_guard guard(mutex_);
+	return bound_count_ == threads_.size();
+}
+
+void NodeThreadPool::Run() {
+	const bool bound = BindCurrentThreadToNode(node_);
+	std::unique_lock guard(mutex_);
+	if (bound) {
+		++bound_count_;
+	}
+	++started_count_;
+	cv_.notify_all();
+	while (true) {
+		cv_.wait(guard, [this] {
+			return stop_ || !tasks_.empty();
+		});
+		if (tasks_.empty()) {
+			return;
+		}
+		auto task = std::move(tasks_.front());
+		tasks_.pop();
+		guard.unlock();
+		task();
+		guard.lock();
+	}
+}
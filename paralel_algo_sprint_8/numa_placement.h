@@ -0,0 +1,66 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Процессоры каждого узла NUMA из списка включённых узлов. Если топология недоступна,
+// считается, что узел один и ему принадлежат все процессоры.
+// Узлы нумеруются подряд; номер узла в ядре может быть другим, его возвращает GetNumaNodeId
+const std::vector<std::vector<int>>& GetNumaNodeCpus();
+size_t GetNumaNodeCount();
+int GetNumaNodeId(size_t node);
+
+// Привязывает текущий поток к процессорам узла и делает узел предпочтительным
+// для выделения памяти этим потоком. Возвращает false, если система этого не позволяет;
+// поток при этом продолжает работать без привязки
+bool BindCurrentThreadToNode(size_t node);
+
+// Пул потоков, привязанных к одному узлу NUMA
+class NodeThreadPool {
+public:
+	NodeThreadPool(size_t node, size_t thread_count);
+	~NodeThreadPool();
+
+	NodeThreadPool(const NodeThreadPool&) = delete;
+	NodeThreadPool& operator=(const NodeThreadPool&) = delete;
+
+	template <typename Function>
+	auto Submit(Function function) -> std::future<decltype(function())>;
+
+	size_t GetNode() const;
+	// удалось ли привязать потоки пула к узлу
+	bool IsBound() const;
+
+private:
+	const size_t node_;
+	mutable std::mutex mutex_;
+	std::condition_variable cv_;
+	std::queue<std::function<void()>> tasks_;
+	bool stop_ = false;
+	size_t started_count_ = 0;
+	size_t bound_count_ = 0;
+	std::vector<std::thread> threads_;
+
+	void Run();
+};
+
+template <typename Function>
+auto NodeThreadPool::Submit(Function function) -> std::future<decltype(function())> {
+	using Result = decltype(function());
+	auto task = std::make_shared<std::packaged_task<Result()>>(std::move(function));
+	auto result = task->get_future();
+	{
+		std::lock_guard guard(mutex_);
+		tasks_.push([task] {
+			(*task)();
+		});
+	}
+	cv_.notify_one();
+	return result;
+}
@@ -0,0 +1,60 @@
+#include "ordinal_set.h"
+#include <algorithm>
+
+namespace {
+
+// элемент массива — 32 бита, в битовой карте на документ приходится 1 бит
+const size_t BITMAP_DENSITY_DIVISOR = 32;
+
+} // namespace
+
+OrdinalSet::OrdinalSet(uint32_t universe_size, size_t expected_count, std::pmr::memory_resource* resource)
+: is_bitmap_(expected_count > universe_size / BITMAP_DENSITY_DIVISOR)
+, bits_(resource)
+, ordinals_(resource) {
+	if (is_bitmap_) {
+		bits_.assign((static_cast<size_t>(universe_size) + 63) / 64, 0);
+	} else {
+		ordinals_.reserve(expected_count);
+	}
+}
+
+void OrdinalSet::Insert(uint32_t ordinal) {
+	if (is_bitmap_) {
+		bits_[ordinal >> 6] |= uint64_t{1} << (ordinal & 63);
+	} else {
+		ordinals_.push_back(ordinal);
+	}
+}
+
+void OrdinalSet::Seal() {
+	if (!is_bitmap_) {
+		std::sort(ordinals_.begin(), ordinals_.end());
+		ordinals_.erase(std::unique(ordinals_.begin(), ordinals_.end()), ordinals_.end());
+	}
+}
+
+bool OrdinalSet::IsEmpty() const {
+	if (is_bitmap_) {
+		return std::all_of(bits_.begin(), bits_.end(), [](uint64_t word) {
+			return word == 0;
+		});
+	}
+	return ordinals_.empty();
+}
+
+bool OrdinalSet::IsBitmap() const {
+	return is_bitmap_;
+}
+
+bool OrdinalSet::ContainsSorted(uint32_t ordinal) const {
+	return std::binary_search(ordinals_.begin(), ordinals_.end(), ordinal);
+}
+
+void OrdinalBitmap::Insert(uint32_t ordinal) {
+	const size_t word = ordinal >> 6;
+	if (word >= bits_.size()) {
+		bits_.resize(word + 1, 0);
+	}
+	bits_[word] |= uint64_t{1} << (ordinal & 63);
+}
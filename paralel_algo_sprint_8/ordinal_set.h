@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+// Множество порядковых номеров документов из [0, universe_size).
+// Пока элементов мало, хранится отсортированным массивом; если ожидается больше
+// universe_size / 32 элементов, битовая карта не больше массива и используется она
+class OrdinalSet {
+public:
+	OrdinalSet() = default;
+	OrdinalSet(uint32_t universe_size, size_t expected_count, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+	void Insert(uint32_t ordinal);
+	// вызывается после всех Insert
+	void Seal();
+
+	bool Contains(uint32_t ordinal) const {
+		if (is_bitmap_) {
+			return (bits_[ordinal >> 6] >> (ordinal & 63)) & 1;
+		}
+		return !ordinals_.empty() && ContainsSorted(ordinal);
+	}
+
+	bool IsEmpty() const;
+	bool IsBitmap() const;
+
+private:
+	bool is_bitmap_ = false;
+	std::pmr::vector<uint64_t> bits_;
+	std::pmr::vector<uint32_t> ordinals_;
+
+	bool ContainsSorted(uint32_t ordinal) const;
+};
+
+// Битовая карта порядковых номеров, пополняемая по одному, например надгробия запечатанного сегмента
+class OrdinalBitmap {
+public:
+	void Insert(uint32_t ordinal);
+
+	bool Contains(uint32_t ordinal) const {
+		const size_t word = ordinal >> 6;
+		return word < bits_.size() && ((bits_[word] >> (ordinal & 63)) & 1);
+	}
+
+private:
+	std::vector<uint64_t> bits_;
+};
@@ -2,6 +2,10 @@
 
 #include <utility>
 #include <algorithm>
+#include <iterator>
+#include <optional>
+#include <ostream>
+#include <type_traits>
 #include <vector>
 
 template <typename Iterator>
@@ -10,7 +14,7 @@ public:
 	IteratorRange(Iterator begin, Iterator end)
 	: first_(begin)
 	, last_(end)
-	, size_(distance(first_, last_)) {
+	, size_(std::distance(first_, last_)) {
 	}
 
 	Iterator begin() const {
@@ -42,7 +46,7 @@ template <typename Iterator>
 class Paginator {
 public:
 	Paginator(Iterator begin, Iterator end, size_t page_size) {
-		for (size_t left = distance(begin, end); left > 0;) {
+		for (size_t left = std::distance(begin, end); left > 0;) {
 			const size_t current_page_size = std::min(page_size, left);
 			const Iterator current_page_end = next(begin, current_page_size);
 			pages_.push_back({begin, current_page_end});
@@ -70,5 +74,237 @@ private:
 
 template <typename Container>
 auto Paginate(const Container& c, size_t page_size) {
-  return Paginator<decltype(begin(c))>(begin(c), end(c), page_size);
-}
\ No newline at end of file
+  return Paginator<decltype(std::begin(c))>(std::begin(c), std::end(c), page_size);
+}
+
+// Произвольный доступ определяется по операциям, а не по категории: прокси-итераторы,
+// возвращающие элемент по значению, объявляют input_iterator_tag, но умеют it + n и it - it
+template <typename Iterator, typename = void>
+constexpr bool HAS_RANDOM_ACCESS_OPS = false;
+
+template <typename Iterator>
+constexpr bool HAS_RANDOM_ACCESS_OPS<Iterator, std::void_t<
+	decltype(std::declval<const Iterator&>() + std::declval<std::ptrdiff_t>()),
+	decltype(std::declval<const Iterator&>() - std::declval<const Iterator&>())>>
+	= std::is_convertible_v<decltype(std::declval<const Iterator&>() + std::declval<std::ptrdiff_t>()), Iterator>
+	&& std::is_integral_v<decltype(std::declval<const Iterator&>() - std::declval<const Iterator&>())>;
+
+// Страницы вычисляются при обращении, ничего не выделяется заранее.
+// Для итераторов произвольного доступа число страниц и страница N — O(1).
+// Остальные источники, в том числе однопроходные (потоки, генераторы), листаются по порядку:
+// страница читает элементы из общего курсора, а переход к следующей пропускает непрочитанные
+template <typename Iterator, typename Sentinel = Iterator>
+class LazyPaginator {
+public:
+	static constexpr bool IS_RANDOM_ACCESS = std::is_same_v<Iterator, Sentinel> && HAS_RANDOM_ACCESS_OPS<Iterator>;
+
+	LazyPaginator(Iterator begin, Sentinel end, size_t page_size)
+	: begin_(begin)
+	, end_(end)
+	, page_size_(std::max<size_t>(page_size, 1))
+	, left_(page_size_) {
+	}
+
+	// страница однопроходного источника
+	class StreamPage {
+	public:
+		class ElementIterator {
+		public:
+			using iterator_category = std::input_iterator_tag;
+			using value_type = typename std::iterator_traits<Iterator>::value_type;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = typename std::iterator_traits<Iterator>::reference;
+
+			explicit ElementIterator(LazyPaginator* paginator)
+			: paginator_(paginator) {
+			}
+
+			reference operator*() const {
+				return *paginator_->begin_;
+			}
+
+			ElementIterator& operator++() {
+				++paginator_->begin_;
+				--paginator_->left_;
+				return *this;
+			}
+
+			bool operator==(const ElementIterator& other) const {
+				return IsDone() == other.IsDone();
+			}
+
+			bool operator!=(const ElementIterator& other) const {
+				return !(*this == other);
+			}
+
+		private:
+			// nullptr — конец страницы
+			LazyPaginator* paginator_;
+
+			bool IsDone() const {
+				return !paginator_ || paginator_->left_ == 0 || paginator_->begin_ == paginator_->end_;
+			}
+		};
+
+		explicit StreamPage(LazyPaginator* paginator)
+		: paginator_(paginator) {
+		}
+
+		ElementIterator begin() const {
+			return ElementIterator(paginator_);
+		}
+
+		ElementIterator end() const {
+			return ElementIterator(nullptr);
+		}
+
+	private:
+		LazyPaginator* paginator_;
+	};
+
+	using Page = std::conditional_t<IS_RANDOM_ACCESS, IteratorRange<Iterator>, StreamPage>;
+
+	class PageIterator {
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = Page;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = Page;
+
+		PageIterator(LazyPaginator* paginator, size_t index)
+		: paginator_(paginator)
+		, index_(index) {
+		}
+
+		Page operator*() const {
+			if constexpr (IS_RANDOM_ACCESS) {
+				return (*paginator_)[index_];
+			} else {
+				return StreamPage(paginator_);
+			}
+		}
+
+		PageIterator& operator++() {
+			if constexpr (IS_RANDOM_ACCESS) {
+				++index_;
+			} else {
+				paginator_->SkipPage();
+			}
+			return *this;
+		}
+
+		bool operator==(const PageIterator& other) const {
+			if constexpr (IS_RANDOM_ACCESS) {
+				return index_ == other.index_;
+			} else {
+				return IsDone() == other.IsDone();
+			}
+		}
+
+		bool operator!=(const PageIterator& other) const {
+			return !(*this == other);
+		}
+
+	private:
+		// у однопроходного источника конец — nullptr
+		LazyPaginator* paginator_;
+		size_t index_;
+
+		bool IsDone() const {
+			return !paginator_ || paginator_->begin_ == paginator_->end_;
+		}
+	};
+
+	PageIterator begin() {
+		return PageIterator(this, 0);
+	}
+
+	PageIterator end() {
+		if constexpr (IS_RANDOM_ACCESS) {
+			return PageIterator(this, size());
+		} else {
+			return PageIterator(nullptr, 0);
+		}
+	}
+
+	// число страниц, O(1)
+	size_t size() const {
+		static_assert(IS_RANDOM_ACCESS, "Page count needs random access iterators");
+		return (static_cast<size_t>(end_ - begin_) + page_size_ - 1) / page_size_;
+	}
+
+	// страница index без обхода предыдущих, O(1)
+	IteratorRange<Iterator> operator[](size_t index) const {
+		static_assert(IS_RANDOM_ACCESS, "Page access by index needs random access iterators");
+		const size_t element_count = end_ - begin_;
+		const size_t first = std::min(index * page_size_, element_count);
+		const size_t last = std::min(first + page_size_, element_count);
+		return {begin_ + first, begin_ + last};
+	}
+
+private:
+	Iterator begin_;
+	Sentinel end_;
+	size_t page_size_;
+	// сколько элементов текущей страницы однопроходного источника ещё не прочитано
+	size_t left_;
+
+	void SkipPage() {
+		for (; left_ > 0 && begin_ != end_; --left_) {
+			++begin_;
+		}
+		left_ = page_size_;
+	}
+};
+
+template <typename Container>
+auto PaginateLazy(const Container& c, size_t page_size) {
+	return LazyPaginator<decltype(std::begin(c))>(std::begin(c), std::end(c), page_size);
+}
+
+// Однопроходный итератор по генератору: generator() возвращает std::optional<T>, std::nullopt — конец
+template <typename Generator>
+class GeneratorIterator {
+public:
+	using value_type = typename std::invoke_result_t<Generator&>::value_type;
+	using iterator_category = std::input_iterator_tag;
+	using difference_type = std::ptrdiff_t;
+	using pointer = const value_type*;
+	using reference = const value_type&;
+
+	// конец последовательности
+	GeneratorIterator() = default;
+
+	explicit GeneratorIterator(Generator& generator)
+	: generator_(&generator)
+	, value_(generator()) {
+	}
+
+	reference operator*() const {
+		return *value_;
+	}
+
+	GeneratorIterator& operator++() {
+		value_ = (*generator_)();
+		return *this;
+	}
+
+	bool operator==(const GeneratorIterator& other) const {
+		return !value_ && !other.value_;
+	}
+
+	bool operator!=(const GeneratorIterator& other) const {
+		return !(*this == other);
+	}
+
+private:
+	Generator* generator_ = nullptr;
+	std::optional<value_type> value_;
+};
+
+template <typename Generator>
+auto PaginateGenerator(Generator& generator, size_t page_size) {
+	return LazyPaginator<GeneratorIterator<Generator>>(GeneratorIterator<Generator>(generator), GeneratorIterator<Generator>(), page_size);
+}
@@ -0,0 +1,324 @@
+#include "posting_kernels.h"
+#include <algorithm>
+#include <array>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define POSTING_KERNELS_X86 1
+#endif
+
+namespace {
+
+// во сколько раз длинный список должен превосходить короткий, чтобы выгоднее был галоп
+const size_t GALLOPING_SIZE_RATIO = 32;
+
+size_t IntersectScalar(const uint32_t* lhs, size_t lhs_size, const uint32_t* rhs, size_t rhs_size, uint32_t* out) {
+	size_t i = 0;
+	size_t j = 0;
+	size_t count = 0;
+	while (i < lhs_size && j < rhs_size) {
+		if (lhs[i] < rhs[j]) {
+			++i;
+		} else if (rhs[j] < lhs[i]) {
+			++j;
+		} else {
+			out[count++] = lhs[i];
+			++i;
+			++j;
+		}
+	}
+	return count;
+}
+
+#ifdef POSTING_KERNELS_X86
+
+// маски _mm_shuffle_epi8, сдвигающие отмеченные битами маски 32-битные элементы в начало
+std::array<std::array<uint8_t, 16>, 16> BuildSseCompactMasks() {
+	std::array<std::array<uint8_t, 16>, 16> masks{};
+	for (int mask = 0; mask < 16; ++mask) {
+		size_t position = 0;
+		for (int element = 0; element < 4; ++element) {
+			if (mask & (1 << element)) {
+				for (int byte = 0; byte < 4; ++byte) {
+					masks[mask][position++] = element * 4 + byte;
+				}
+			}
+		}
+		while (position < 16) {
+			masks[mask][position++] = 0x80;
+		}
+	}
+	return masks;
+}
+
+// перестановки _mm256_permutevar8x32_epi32 с той же целью
+std::array<std::array<uint32_t, 8>, 256> BuildAvxCompactPermutations() {
+	std::array<std::array<uint32_t, 8>, 256> permutations{};
+	for (int mask = 0; mask < 256; ++mask) {
+		size_t position = 0;
+		for (uint32_t element = 0; element < 8; ++element) {
+			if (mask & (1 << element)) {
+				permutations[mask][position++] = element;
+			}
+		}
+	}
+	return permutations;
+}
+
+const std::array<std::array<uint8_t, 16>, 16> SSE_COMPACT_MASKS = BuildSseCompactMasks();
+const std::array<std::array<uint32_t, 8>, 256> AVX_COMPACT_PERMUTATIONS = BuildAvxCompactPermutations();
+
+// блок lhs сравнивается со всеми циклическими сдвигами блока rhs; продвигается блок с меньшим максимумом
+__attribute__((target("ssse3")))
+size_t IntersectSse(const uint32_t* lhs, size_t lhs_size, const uint32_t* rhs, size_t rhs_size, uint32_t* out) {
+	size_t i = 0;
+	size_t j = 0;
+	size_t count = 0;
+	while (i + 4 <= lhs_size && j + 4 <= rhs_size) {
+		const __m128i lhs_block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs + i));
+		const __m128i rhs_block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs + j));
+		__m128i equal = _mm_cmpeq_epi32(lhs_block, rhs_block);
+		equal = _mm_or_si128(equal, _mm_cmpeq_epi32(lhs_block, _mm_shuffle_epi32(rhs_block, _MM_SHUFFLE(0, 3, 2, 1))));
+		equal = _mm_or_si128(equal, _mm_cmpeq_epi32(lhs_block, _mm_shuffle_epi32(rhs_block, _MM_SHUFFLE(1, 0, 3, 2))));
+		equal = _mm_or_si128(equal, _mm_cmpeq_epi32(lhs_block, _mm_shuffle_epi32(rhs_block, _MM_SHUFFLE(2, 1, 0, 3))));
+		const int mask = _mm_movemask_ps(_mm_castsi128_ps(equal));
+		const __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(SSE_COMPACT_MASKS[mask].data()));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + count), _mm_shuffle_epi8(lhs_block, shuffle));
+		count += __builtin_popcount(mask);
+
+		const uint32_t lhs_max = lhs[i + 3];
+		const uint32_t rhs_max = rhs[j + 3];
+		i += lhs_max <= rhs_max ? 4 : 0;
+		j += rhs_max <= lhs_max ? 4 : 0;
+	}
+	return count + IntersectScalar(lhs + i, lhs_size - i, rhs + j, rhs_size - j, out + count);
+}
+
+__attribute__((target("avx2")))
+size_t IntersectAvx2(const uint32_t* lhs, size_t lhs_size, const uint32_t* rhs, size_t rhs_size, uint32_t* out) {
+	size_t i = 0;
+	size_t j = 0;
+	size_t count = 0;
+	const __m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+	while (i + 8 <= lhs_size && j + 8 <= rhs_size) {
+		const __m256i lhs_block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i));
+		__m256i rhs_block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + j));
+		__m256i equal = _mm256_cmpeq_epi32(lhs_block, rhs_block);
+		for (int shift = 1; shift < 8; ++shift) {
+			rhs_block = _mm256_permutevar8x32_epi32(rhs_block, rotate);
+			equal = _mm256_or_si256(equal, _mm256_cmpeq_epi32(lhs_block, rhs_block));
+		}
+		const int mask = _mm256_movemask_ps(_mm256_castsi256_ps(equal));
+		const __m256i permutation = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(AVX_COMPACT_PERMUTATIONS[mask].data()));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + count), _mm256_permutevar8x32_epi32(lhs_block, permutation));
+		count += __builtin_popcount(mask);
+
+		const uint32_t lhs_max = lhs[i + 7];
+		const uint32_t rhs_max = rhs[j + 7];
+		i += lhs_max <= rhs_max ? 8 : 0;
+		j += rhs_max <= lhs_max ? 8 : 0;
+	}
+	// как в SumRatingsAvx2: vzeroupper явно, не полагаясь на то, что GCC вставит его на всех путях к выходу
+	_mm256_zeroupper();
+	return count + IntersectScalar(lhs + i, lhs_size - i, rhs + j, rhs_size - j, out + count);
+}
+
+#endif
+
+} // namespace
+
+bool IsPostingKernelSupported(PostingKernel kernel) {
+	switch (kernel) {
+	case PostingKernel::SCALAR:
+		return true;
+#ifdef POSTING_KERNELS_X86
+	case PostingKernel::SSE:
+		return __builtin_cpu_supports("ssse3");
+	case PostingKernel::AVX2:
+		return __builtin_cpu_supports("avx2");
+#endif
+	default:
+		return false;
+	}
+}
+
+PostingKernel GetPostingKernel() {
+	static const PostingKernel kernel = [] {
+		for (const PostingKernel candidate : {PostingKernel::AVX2, PostingKernel::SSE}) {
+			if (IsPostingKernelSupported(candidate)) {
+				return candidate;
+			}
+		}
+		return PostingKernel::SCALAR;
+	}();
+	return kernel;
+}
+
+const char* GetPostingKernelName(PostingKernel kernel) {
+	switch (kernel) {
+	case PostingKernel::SCALAR:
+		return "scalar";
+	case PostingKernel::SSE:
+		return "sse";
+	case PostingKernel::AVX2:
+		return "avx2";
+	}
+	return "unknown";
+}
+
+size_t IntersectSorted(PostingKernel kernel, const uint32_t* lhs, size_t lhs_size, const uint32_t* rhs, size_t rhs_size, uint32_t* out) {
+#ifdef POSTING_KERNELS_X86
+	if (kernel == PostingKernel::AVX2) {
+		return IntersectAvx2(lhs, lhs_size, rhs, rhs_size, out);
+	}
+	if (kernel == PostingKernel::SSE) {
+		return IntersectSse(lhs, lhs_size, rhs, rhs_size, out);
+	}
+#endif
+	return IntersectScalar(lhs, lhs_size, rhs, rhs_size, out);
+}
+
+namespace {
+
+// первый элемент [it, end) не меньше value: шаги от it удваиваются, затем двоичный поиск
+const uint32_t* GallopLowerBound(const uint32_t* it, const uint32_t* end, uint32_t value) {
+	size_t step = 1;
+	const uint32_t* bound = it;
+	while (bound != end && *bound < value) {
+		it = bound + 1;
+		bound = static_cast<size_t>(end - bound) > step ? bound + step : end;
+		step *= 2;
+	}
+	return std::lower_bound(it, bound, value);
+}
+
+} // namespace
+
+size_t IntersectGalloping(const uint32_t* small, size_t small_size, const uint32_t* large, size_t large_size, uint32_t* out) {
+	size_t count = 0;
+	const uint32_t* it = large;
+	const uint32_t* const end = large + large_size;
+	for (size_t i = 0; i < small_size && it != end; ++i) {
+		const uint32_t value = small[i];
+		it = GallopLowerBound(it, end, value);
+		if (it != end && *it == value) {
+			out[count++] = value;
+			++it;
+		}
+	}
+	return count;
+}
+
+size_t IntersectPositions(const uint32_t* candidates, size_t candidates_size, const uint32_t* postings, size_t postings_size, uint32_t* positions) {
+	size_t count = 0;
+	if (candidates_size * GALLOPING_SIZE_RATIO < postings_size) {
+		count = IntersectGalloping(candidates, candidates_size, postings, postings_size, positions);
+	} else if (postings_size * GALLOPING_SIZE_RATIO < candidates_size) {
+		count = IntersectGalloping(postings, postings_size, candidates, candidates_size, positions);
+	} else {
+		count = IntersectSorted(GetPostingKernel(), candidates, candidates_size, postings, postings_size, positions);
+	}
+	// найденные элементы по возрастанию: каждый ищется от позиции предыдущего
+	const uint32_t* it = postings;
+	const uint32_t* const end = postings + postings_size;
+	for (size_t i = 0; i < count; ++i) {
+		it = GallopLowerBound(it, end, positions[i]);
+		positions[i] = static_cast<uint32_t>(it - postings);
+		++it;
+	}
+	return count;
+}
+
+namespace {
+
+// результат получает распределитель lhs
+template <typename Vector>
+Vector IntersectVectors(const Vector& lhs, const Vector& rhs) {
+	const Vector& small = lhs.size() <= rhs.size() ? lhs : rhs;
+	const Vector& large = lhs.size() <= rhs.size() ? rhs : lhs;
+	Vector result(small.size() + 8, lhs.get_allocator());
+	size_t count = 0;
+	if (small.size() * GALLOPING_SIZE_RATIO < large.size()) {
+		count = IntersectGalloping(small.data(), small.size(), large.data(), large.size(), result.data());
+	} else {
+		count = IntersectSorted(GetPostingKernel(), small.data(), small.size(), large.data(), large.size(), result.data());
+	}
+	result.resize(count);
+	return result;
+}
+
+// Отрезки длинного списка между элементами короткого копируются целиком, граница ищется галопом:
+// O(m log(n / m)) сравнений вместо O(n + m) у слияния
+template <typename Vector>
+void UniteGalloping(const Vector& small, const Vector& large, Vector& result) {
+	const uint32_t* it = large.data();
+	const uint32_t* const end = large.data() + large.size();
+	for (const uint32_t value : small) {
+		const uint32_t* const next = GallopLowerBound(it, end, value);
+		result.insert(result.end(), it, next);
+		result.push_back(value);
+		it = next != end && *next == value ? next + 1 : next;
+	}
+	result.insert(result.end(), it, end);
+}
+
+template <typename Vector>
+Vector UniteVectors(const Vector& lhs, const Vector& rhs) {
+	Vector result(lhs.get_allocator());
+	result.reserve(lhs.size() + rhs.size());
+	if (lhs.size() * GALLOPING_SIZE_RATIO < rhs.size()) {
+		UniteGalloping(lhs, rhs, result);
+	} else if (rhs.size() * GALLOPING_SIZE_RATIO < lhs.size()) {
+		UniteGalloping(rhs, lhs, result);
+	} else {
+		std::set_union(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::back_inserter(result));
+	}
+	return result;
+}
+
+} // namespace
+
+std::vector<uint32_t> IntersectSorted(const std::vector<uint32_t>& lhs, const std::vector<uint32_t>& rhs) {
+	return IntersectVectors(lhs, rhs);
+}
+
+std::vector<uint32_t> UniteSorted(const std::vector<uint32_t>& lhs, const std::vector<uint32_t>& rhs) {
+	return UniteVectors(lhs, rhs);
+}
+
+std::pmr::vector<uint32_t> IntersectSorted(const std::pmr::vector<uint32_t>& lhs, const std::pmr::vector<uint32_t>& rhs) {
+	return IntersectVectors(lhs, rhs);
+}
+
+std::pmr::vector<uint32_t> UniteSorted(const std::pmr::vector<uint32_t>& lhs, const std::pmr::vector<uint32_t>& rhs) {
+	return UniteVectors(lhs, rhs);
+}
+
+std::vector<uint32_t> SubtractSorted(const std::vector<uint32_t>& lhs, const std::vector<uint32_t>& rhs) {
+	std::vector<uint32_t> result;
+	result.reserve(lhs.size());
+	const uint32_t* it = rhs.data();
+	const uint32_t* const end = rhs.data() + rhs.size();
+	if (lhs.size() * GALLOPING_SIZE_RATIO < rhs.size()) {
+		// каждый элемент короткого lhs ищется в rhs галопом
+		for (const uint32_t value : lhs) {
+			it = GallopLowerBound(it, end, value);
+			if (it == end || *it != value) {
+				result.push_back(value);
+			}
+		}
+	} else if (rhs.size() * GALLOPING_SIZE_RATIO < lhs.size()) {
+		// отрезки lhs между вычитаемыми элементами копируются целиком
+		const uint32_t* from = lhs.data();
+		const uint32_t* const lhs_end = lhs.data() + lhs.size();
+		for (; it != end; ++it) {
+			const uint32_t* const next = GallopLowerBound(from, lhs_end, *it);
+			result.insert(result.end(), from, next);
+			from = next != lhs_end && *next == *it ? next + 1 : next;
+		}
+		result.insert(result.end(), from, lhs_end);
+	} else {
+		std::set_difference(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::back_inserter(result));
+	}
+	return result;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+// Операции над отсортированными списками id документов без повторов
+enum class PostingKernel {
+	SCALAR,
+	SSE,
+	AVX2,
+};
+
+// лучшая реализация, доступная процессору; определяется при первом вызове
+PostingKernel GetPostingKernel();
+bool IsPostingKernelSupported(PostingKernel kernel);
+const char* GetPostingKernelName(PostingKernel kernel);
+
+// пересечение блоками по 4 или 8 элементов; блок записывается в out целиком,
+// поэтому out вмещает min(lhs_size, rhs_size) + 8 элементов. Возвращает число найденных элементов
+size_t IntersectSorted(PostingKernel kernel, const uint32_t* lhs, size_t lhs_size, const uint32_t* rhs, size_t rhs_size, uint32_t* out);
+// элементы короткого списка ищутся в длинном экспоненциальным поиском
+size_t IntersectGalloping(const uint32_t* small, size_t small_size, const uint32_t* large, size_t large_size, uint32_t* out);
+// Позиции в postings элементов candidates, которые в нём есть, по возрастанию. Общие элементы ищет
+// IntersectSorted или галоп, позиции — галоп вперёд по postings; positions вмещает min(размеров) + 8
+size_t IntersectPositions(const uint32_t* candidates, size_t candidates_size, const uint32_t* postings, size_t postings_size, uint32_t* positions);
+
+// Выбирают галоп при сильно разной длине списков. Иначе пересечение идёт блоками лучшей
+// реализацией, а объединение и разность — обычным слиянием std: SIMD ускоряет только пересечение
+std::vector<uint32_t> IntersectSorted(const std::vector<uint32_t>& lhs, const std::vector<uint32_t>& rhs);
+std::vector<uint32_t> UniteSorted(const std::vector<uint32_t>& lhs, const std::vector<uint32_t>& rhs);
+// то же, результат размещается в памяти lhs
+std::pmr::vector<uint32_t> IntersectSorted(const std::pmr::vector<uint32_t>& lhs, const std::pmr::vector<uint32_t>& rhs);
+std::pmr::vector<uint32_t> UniteSorted(const std::pmr::vector<uint32_t>& lhs, const std::pmr::vector<uint32_t>& rhs);
+// элементы lhs, которых нет в rhs
+std::vector<uint32_t> SubtractSorted(const std::vector<uint32_t>& lhs, const std::vector<uint32_t>& rhs);
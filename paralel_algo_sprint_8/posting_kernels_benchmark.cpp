@@ -0,0 +1,79 @@
+#include "posting_kernels.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <random>
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+const int REPEAT_COUNT = 20;
+
+vector<uint32_t> GenerateSorted(mt19937& generator, size_t size, uint32_t universe) {
+	vector<uint32_t> values(size);
+	for (uint32_t& value : values) {
+		value = uniform_int_distribution<uint32_t>(0, universe - 1)(generator);
+	}
+	sort(values.begin(), values.end());
+	values.erase(unique(values.begin(), values.end()), values.end());
+	return values;
+}
+
+// миллионы элементов входа в секунду
+template <typename Intersect>
+double Measure(const vector<uint32_t>& lhs, const vector<uint32_t>& rhs, vector<uint32_t>& out, size_t& count, Intersect intersect) {
+	const auto start = Clock::now();
+	for (int i = 0; i < REPEAT_COUNT; ++i) {
+		count = intersect(lhs, rhs, out);
+	}
+	const chrono::duration<double> elapsed = Clock::now() - start;
+	return REPEAT_COUNT * (lhs.size() + rhs.size()) / elapsed.count() / 1e6;
+}
+
+} // namespace
+
+int main() {
+	mt19937 generator(42);
+	const uint32_t universe = 10'000'000;
+	cout << "best kernel: "s << GetPostingKernelName(GetPostingKernel()) << endl;
+	cout << "Melements/s"s << endl;
+	for (const auto& [lhs_size, rhs_size] : {pair<size_t, size_t>{1'000'000, 1'000'000}, {1'000'000, 100'000}, {1'000'000, 10'000}, {1'000'000, 100}}) {
+		const vector<uint32_t> lhs = GenerateSorted(generator, lhs_size, universe);
+		const vector<uint32_t> rhs = GenerateSorted(generator, rhs_size, universe);
+		vector<uint32_t> out(min(lhs.size(), rhs.size()) + 8);
+		cout << lhs.size() << " x "s << rhs.size() << ':';
+
+		size_t expected = 0;
+		cout << " std="s << fixed << setprecision(1) << Measure(lhs, rhs, out, expected,
+			[](const auto& lhs, const auto& rhs, auto& out) {
+				return set_intersection(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), out.begin()) - out.begin();
+			});
+		for (const PostingKernel kernel : {PostingKernel::SCALAR, PostingKernel::SSE, PostingKernel::AVX2}) {
+			if (!IsPostingKernelSupported(kernel)) {
+				continue;
+			}
+			size_t count = 0;
+			cout << ' ' << GetPostingKernelName(kernel) << '=' << Measure(lhs, rhs, out, count,
+				[kernel](const auto& lhs, const auto& rhs, auto& out) {
+					return IntersectSorted(kernel, lhs.data(), lhs.size(), rhs.data(), rhs.size(), out.data());
+				});
+			if (count != expected) {
+				cout << "(mismatch)"s;
+			}
+		}
+		size_t count = 0;
+		cout << " galloping="s << Measure(lhs, rhs, out, count,
+			[](const auto& lhs, const auto& rhs, auto& out) {
+				return IntersectGalloping(rhs.data(), rhs.size(), lhs.data(), lhs.size(), out.data());
+			});
+		if (count != expected) {
+			cout << "(mismatch)"s;
+		}
+		cout << endl;
+	}
+}
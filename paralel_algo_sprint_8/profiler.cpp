@@ -0,0 +1,261 @@
+#include "profiler.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct SiteStats {
+	std::atomic<uint64_t> calls{0};
+	std::atomic<uint64_t> total_ns{0};
+	std::atomic<uint64_t> min_ns{UINT64_MAX};
+	std::atomic<uint64_t> max_ns{0};
+};
+
+struct TraceEvent {
+	size_t site_index;
+	int64_t start_ns;
+	int64_t duration_ns;
+};
+
+// буфер потока: сводку пишет только владелец, читатель видит её через relaxed-загрузки
+struct ThreadProfile {
+	size_t thread_index = 0;
+	std::array<SiteStats, MAX_PROFILE_SITES> sites;
+	std::mutex trace_mutex;
+	std::vector<TraceEvent> trace;
+	size_t trace_next = 0;
+};
+
+struct SiteSummary {
+	const ProfileSite* site;
+	uint64_t calls = 0;
+	uint64_t total_ns = 0;
+	uint64_t min_ns = UINT64_MAX;
+	uint64_t max_ns = 0;
+};
+
+struct RetiredTraceEvent {
+	size_t thread_index;
+	TraceEvent event;
+};
+
+// сводка и события завершившихся потоков; событий не больше PROFILE_TRACE_CAPACITY на всех
+struct RetiredProfile {
+	std::array<SiteSummary, MAX_PROFILE_SITES> sites{};
+	std::vector<RetiredTraceEvent> trace;
+	size_t trace_next = 0;
+};
+
+struct ProfilerRegistry {
+	std::mutex mutex;
+	std::vector<const ProfileSite*> sites;
+	std::vector<ThreadProfile*> threads;
+	size_t next_thread_index = 0;
+	RetiredProfile retired;
+	const Clock::time_point start_time = Clock::now();
+	std::atomic<bool> tracing{false};
+};
+
+ProfilerRegistry& GetRegistry() {
+	static ProfilerRegistry registry;
+	return registry;
+}
+
+// кольцевой буфер: при переполнении затирается самый старый элемент
+template <typename Event>
+void PushTraceEvent(std::vector<Event>& trace, size_t& trace_next, const Event& event) {
+	if (trace.size() < PROFILE_TRACE_CAPACITY) {
+		trace.push_back(event);
+	} else {
+		trace[trace_next] = event;
+		trace_next = (trace_next + 1) % PROFILE_TRACE_CAPACITY;
+	}
+}
+
+void AddSiteStats(SiteSummary& summary, uint64_t calls, uint64_t total_ns, uint64_t min_ns, uint64_t max_ns) {
+	summary.calls += calls;
+	summary.total_ns += total_ns;
+	summary.min_ns = std::min(summary.min_ns, min_ns);
+	summary.max_ns = std::max(summary.max_ns, max_ns);
+}
+
+// при завершении потока переносит его сводку и события в RetiredProfile и освобождает буфер
+class ThreadProfileOwner {
+public:
+	ThreadProfileOwner() {
+		ProfilerRegistry& registry = GetRegistry();
+		std::lock_guard guard(registry.mutex);
+		profile_.thread_index = registry.next_thread_index++;
+		registry.threads.push_back(&profile_);
+	}
+
+	~ThreadProfileOwner() {
+		ProfilerRegistry& registry = GetRegistry();
+		std::lock_guard guard(registry.mutex);
+		RetiredProfile& retired = registry.retired;
+		for (size_t index = 0; index < MAX_PROFILE_SITES; ++index) {
+			const SiteStats& stats = profile_.sites[index];
+			AddSiteStats(retired.sites[index], stats.calls.load(std::memory_order_relaxed), stats.total_ns.load(std::memory_order_relaxed),
+				stats.min_ns.load(std::memory_order_relaxed), stats.max_ns.load(std::memory_order_relaxed));
+		}
+		// от старых событий к новым, чтобы вытеснялись самые старые
+		std::rotate(profile_.trace.begin(), profile_.trace.begin() + profile_.trace_next, profile_.trace.end());
+		for (const TraceEvent& event : profile_.trace) {
+			PushTraceEvent(retired.trace, retired.trace_next, RetiredTraceEvent{profile_.thread_index, event});
+		}
+		registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), &profile_));
+	}
+
+	ThreadProfileOwner(const ThreadProfileOwner&) = delete;
+	ThreadProfileOwner& operator=(const ThreadProfileOwner&) = delete;
+
+	ThreadProfile& Get() {
+		return profile_;
+	}
+
+private:
+	ThreadProfile profile_;
+};
+
+ThreadProfile& GetThreadProfile() {
+	thread_local ThreadProfileOwner owner;
+	return owner.Get();
+}
+
+void Store(std::atomic<uint64_t>& value, uint64_t new_value) {
+	value.store(new_value, std::memory_order_relaxed);
+}
+
+uint64_t Load(const std::atomic<uint64_t>& value) {
+	return value.load(std::memory_order_relaxed);
+}
+
+void PrintEscaped(std::ostream& out, const char* text) {
+	for (; *text; ++text) {
+		if (*text == '"' || *text == '\\') {
+			out << '\\';
+		}
+		out << *text;
+	}
+}
+
+} // namespace
+
+ProfileSite::ProfileSite(const char* name, const char* file, int line)
+: name_(name)
+, file_(file)
+, line_(line) {
+	ProfilerRegistry& registry = GetRegistry();
+	std::lock_guard guard(registry.mutex);
+	index_ = std::min(registry.sites.size(), MAX_PROFILE_SITES);
+	if (index_ < MAX_PROFILE_SITES) {
+		registry.sites.push_back(this);
+	}
+}
+
+const char* ProfileSite::GetName() const {
+	return name_;
+}
+
+const char* ProfileSite::GetFile() const {
+	return file_;
+}
+
+int ProfileSite::GetLine() const {
+	return line_;
+}
+
+size_t ProfileSite::GetIndex() const {
+	return index_;
+}
+
+void RecordProfileSample(const ProfileSite& site, Clock::time_point start_time, Clock::time_point finish_time) {
+	const size_t index = site.GetIndex();
+	if (index >= MAX_PROFILE_SITES) {
+		return;
+	}
+	const uint64_t duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(finish_time - start_time).count();
+	ThreadProfile& profile = GetThreadProfile();
+	SiteStats& stats = profile.sites[index];
+	Store(stats.calls, Load(stats.calls) + 1);
+	Store(stats.total_ns, Load(stats.total_ns) + duration_ns);
+	Store(stats.min_ns, std::min(Load(stats.min_ns), duration_ns));
+	Store(stats.max_ns, std::max(Load(stats.max_ns), duration_ns));
+
+	ProfilerRegistry& registry = GetRegistry();
+	if (!registry.tracing.load(std::memory_order_relaxed)) {
+		return;
+	}
+	const TraceEvent event{index, std::chrono::duration_cast<std::chrono::nanoseconds>(start_time - registry.start_time).count(),
+		static_cast<int64_t>(duration_ns)};
+	std::lock_guard guard(profile.trace_mutex);
+	PushTraceEvent(profile.trace, profile.trace_next, event);
+}
+
+void SetProfilerTracing(bool enabled) {
+	GetRegistry().tracing.store(enabled, std::memory_order_relaxed);
+}
+
+void PrintFlatProfile(std::ostream& out) {
+	ProfilerRegistry& registry = GetRegistry();
+	std::vector<SiteSummary> summaries;
+	{
+		std::lock_guard guard(registry.mutex);
+		for (const ProfileSite* site : registry.sites) {
+			SiteSummary summary = registry.retired.sites[site->GetIndex()];
+			summary.site = site;
+			for (const ThreadProfile* profile : registry.threads) {
+				const SiteStats& stats = profile->sites[site->GetIndex()];
+				AddSiteStats(summary, Load(stats.calls), Load(stats.total_ns), Load(stats.min_ns), Load(stats.max_ns));
+			}
+			if (summary.calls > 0) {
+				summaries.push_back(summary);
+			}
+		}
+	}
+	std::sort(summaries.begin(), summaries.end(), [](const SiteSummary& lhs, const SiteSummary& rhs) {
+		return lhs.total_ns > rhs.total_ns;
+	});
+
+	out << std::left << std::setw(32) << "name" << std::right << std::setw(12) << "calls" << std::setw(16) << "total ns"
+		<< std::setw(14) << "avg ns" << std::setw(14) << "min ns" << std::setw(14) << "max ns" << "  location\n";
+	for (const SiteSummary& summary : summaries) {
+		out << std::left << std::setw(32) << summary.site->GetName() << std::right << std::setw(12) << summary.calls
+			<< std::setw(16) << summary.total_ns << std::setw(14) << summary.total_ns / summary.calls
+			<< std::setw(14) << summary.min_ns << std::setw(14) << summary.max_ns
+			<< "  " << summary.site->GetFile() << ':' << summary.site->GetLine() << '\n';
+	}
+}
+
+void PrintChromeTrace(std::ostream& out) {
+	ProfilerRegistry& registry = GetRegistry();
+	std::lock_guard guard(registry.mutex);
+	out << "{\"traceEvents\":[";
+	bool is_first = true;
+	const auto print_event = [&](size_t thread_index, const TraceEvent& event) {
+		const ProfileSite* site = registry.sites[event.site_index];
+		out << (is_first ? "\n" : ",\n") << "{\"name\":\"";
+		PrintEscaped(out, site->GetName());
+		out << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << thread_index
+			<< ",\"ts\":" << event.start_ns / 1000 << '.' << std::setfill('0') << std::setw(3) << event.start_ns % 1000
+			<< ",\"dur\":" << event.duration_ns / 1000 << '.' << std::setw(3) << event.duration_ns % 1000 << std::setfill(' ') << '}';
+		is_first = false;
+	};
+	for (const RetiredTraceEvent& retired_event : registry.retired.trace) {
+		print_event(retired_event.thread_index, retired_event.event);
+	}
+	for (ThreadProfile* profile : registry.threads) {
+		std::lock_guard trace_guard(profile->trace_mutex);
+		for (const TraceEvent& event : profile->trace) {
+			print_event(profile->thread_index, event);
+		}
+	}
+	out << "\n]}\n";
+}
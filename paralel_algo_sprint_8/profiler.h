@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+
+#define PROFILER_CONCAT_INTERNAL(X, Y) X##Y
+#define PROFILER_CONCAT(X, Y) PROFILER_CONCAT_INTERNAL(X, Y)
+// Замер области видимости; name — строковый литерал, статистика копится по месту вызова
+#define PROFILE_SCOPE(name) \
+	static const ProfileSite PROFILER_CONCAT(profile_site_, __LINE__)("" name, __FILE__, __LINE__); \
+	const ProfileScope PROFILER_CONCAT(profile_scope_, __LINE__)(PROFILER_CONCAT(profile_site_, __LINE__))
+
+const size_t MAX_PROFILE_SITES = 1024;
+// событий трассировки на поток и на все завершившиеся потоки вместе; при переполнении затираются самые старые
+const size_t PROFILE_TRACE_CAPACITY = 1 << 16;
+
+// место вызова PROFILE_SCOPE, регистрируется при первом проходе
+class ProfileSite {
+public:
+	ProfileSite(const char* name, const char* file, int line);
+
+	const char* GetName() const;
+	const char* GetFile() const;
+	int GetLine() const;
+	// MAX_PROFILE_SITES, если мест больше лимита: такие замеры не учитываются
+	size_t GetIndex() const;
+
+private:
+	const char* name_;
+	const char* file_;
+	int line_;
+	size_t index_;
+};
+
+void RecordProfileSample(const ProfileSite& site, std::chrono::steady_clock::time_point start_time,
+	std::chrono::steady_clock::time_point finish_time);
+
+class ProfileScope {
+public:
+	explicit ProfileScope(const ProfileSite& site)
+	: site_(site) {
+	}
+
+	~ProfileScope() {
+		RecordProfileSample(site_, start_time_, std::chrono::steady_clock::now());
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	const ProfileSite& site_;
+	const std::chrono::steady_clock::time_point start_time_ = std::chrono::steady_clock::now();
+};
+
+// Сводка по местам вызова всегда включена: запись — несколько relaxed-операций в буфер потока.
+// Буфер освобождается при завершении потока, его сводка и события переносятся в общий.
+// Трассировка отдельных вызовов включается явно
+void SetProfilerTracing(bool enabled);
+// места вызова по убыванию суммарного времени: число вызовов, сумма, среднее, min, max
+void PrintFlatProfile(std::ostream& out);
+// события в формате Chrome trace (chrome://tracing, Perfetto)
+void PrintChromeTrace(std::ostream& out);
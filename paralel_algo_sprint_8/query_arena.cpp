@@ -0,0 +1,71 @@
+#include "query_arena.h"
+#include <algorithm>
+
+QueryArena::QueryArena(size_t buffer_size)
+: buffer_size_(std::max<size_t>(buffer_size, 1))
+, buffer_(new std::byte[buffer_size_]) {
+	resource_.emplace(buffer_.get(), buffer_size_, &overflow_);
+}
+
+std::pmr::memory_resource* QueryArena::GetResource() {
+	return &*resource_;
+}
+
+void QueryArena::Reset() {
+	resource_->release();
+	const size_t overflow_bytes = overflow_.GetAllocatedBytes();
+	overflow_.ResetAllocatedBytes();
+	if (overflow_bytes == 0 || buffer_size_ >= MAX_QUERY_ARENA_SIZE) {
+		return;
+	}
+	// буфер вырастает до размера, которого хватило бы этому запросу
+	buffer_size_ = std::min(MAX_QUERY_ARENA_SIZE, std::max(buffer_size_ * 2, buffer_size_ + overflow_bytes));
+	resource_.reset();
+	buffer_.reset(new std::byte[buffer_size_]);
+	resource_.emplace(buffer_.get(), buffer_size_, &overflow_);
+}
+
+size_t QueryArena::GetBufferSize() const {
+	return buffer_size_;
+}
+
+QueryArena& QueryArena::GetThreadArena() {
+	thread_local QueryArena arena;
+	return arena;
+}
+
+QueryArena::Scope::Scope(QueryArena& arena)
+: arena_(arena) {
+	++arena_.depth_;
+}
+
+QueryArena::Scope::~Scope() {
+	if (--arena_.depth_ == 0) {
+		arena_.Reset();
+	}
+}
+
+std::pmr::memory_resource* QueryArena::Scope::GetResource() const {
+	return arena_.GetResource();
+}
+
+size_t QueryArena::OverflowResource::GetAllocatedBytes() const {
+	return allocated_bytes_;
+}
+
+void QueryArena::OverflowResource::ResetAllocatedBytes() {
+	allocated_bytes_ = 0;
+}
+
+void* QueryArena::OverflowResource::do_allocate(size_t bytes, size_t alignment) {
+	allocated_bytes_ += bytes;
+	return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void QueryArena::OverflowResource::do_deallocate(void* pointer, size_t bytes, size_t alignment) {
+	std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+}
+
+bool QueryArena::OverflowResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+	return this == &other;
+}
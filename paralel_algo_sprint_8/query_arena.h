@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+const size_t DEFAULT_QUERY_ARENA_SIZE = 64 * 1024;
+// дальше арена не растёт, более крупные запросы добирают память из кучи
+const size_t MAX_QUERY_ARENA_SIZE = 16 * 1024 * 1024;
+
+// Память для временных структур одного запроса: выделение — сдвиг указателя, освобождение —
+// сброс всей арены за O(1). Если запросу не хватило буфера, недостающее берётся из кучи,
+// а при сбросе буфер увеличивается, чтобы следующие такие запросы обходились без кучи.
+// Не потокобезопасна: у каждого потока своя арена
+class QueryArena {
+public:
+	explicit QueryArena(size_t buffer_size = DEFAULT_QUERY_ARENA_SIZE);
+	QueryArena(const QueryArena&) = delete;
+	QueryArena& operator=(const QueryArena&) = delete;
+
+	std::pmr::memory_resource* GetResource();
+	// освобождает всё выделенное в арене
+	void Reset();
+	size_t GetBufferSize() const;
+
+	// арена текущего потока, буфер выделяется при первом обращении
+	static QueryArena& GetThreadArena();
+
+	// Сбрасывает арену при выходе из самого внешнего запроса;
+	// вложенные запросы того же потока размещаются в ней же
+	class Scope {
+	public:
+		explicit Scope(QueryArena& arena);
+		~Scope();
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+		std::pmr::memory_resource* GetResource() const;
+
+	private:
+		QueryArena& arena_;
+	};
+
+private:
+	// куча за буфером арены; считает, сколько памяти в буфер не уместилось
+	class OverflowResource : public std::pmr::memory_resource {
+	public:
+		size_t GetAllocatedBytes() const;
+		void ResetAllocatedBytes();
+
+	private:
+		void* do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+		size_t allocated_bytes_ = 0;
+	};
+
+	OverflowResource overflow_;
+	size_t buffer_size_;
+	std::unique_ptr<std::byte[]> buffer_;
+	std::optional<std::pmr::monotonic_buffer_resource> resource_;
+	int depth_ = 0;
+};
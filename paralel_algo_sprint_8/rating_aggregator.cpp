@@ -0,0 +1,107 @@
+#include "rating_aggregator.h"
+#include <algorithm>
+#include <functional>
+#include <numeric>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RATING_AGGREGATOR_X86 1
+#endif
+
+namespace {
+
+// столько оценок суммирует одна параллельная задача
+const size_t RATING_BLOCK_SIZE = 1 << 14;
+
+int64_t SumRatingsScalar(const int* ratings, size_t count) {
+	int64_t sum = 0;
+	for (size_t i = 0; i < count; ++i) {
+		sum += ratings[i];
+	}
+	return sum;
+}
+
+#ifdef RATING_AGGREGATOR_X86
+
+// SSE2 есть на любом x86-64: знак расширяется распаковкой со старшими битами
+int64_t SumRatingsSse(const int* ratings, size_t count) {
+	__m128i sum = _mm_setzero_si128();
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ratings + i));
+		const __m128i sign = _mm_srai_epi32(block, 31);
+		sum = _mm_add_epi64(sum, _mm_unpacklo_epi32(block, sign));
+		sum = _mm_add_epi64(sum, _mm_unpackhi_epi32(block, sign));
+	}
+	alignas(16) int64_t lanes[2];
+	_mm_store_si128(reinterpret_cast<__m128i*>(lanes), sum);
+	return lanes[0] + lanes[1] + SumRatingsScalar(ratings + i, count - i);
+}
+
+// два независимых накопителя, чтобы сложения не ждали друг друга
+__attribute__((target("avx2")))
+int64_t SumRatingsAvx2(const int* ratings, size_t count) {
+	__m256i sum0 = _mm256_setzero_si256();
+	__m256i sum1 = _mm256_setzero_si256();
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		sum0 = _mm256_add_epi64(sum0, _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ratings + i))));
+		sum1 = _mm256_add_epi64(sum1, _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ratings + i + 4))));
+	}
+	alignas(32) int64_t lanes[4];
+	_mm256_store_si256(reinterpret_cast<__m256i*>(lanes), _mm256_add_epi64(sum0, sum1));
+	// GCC пропускает vzeroupper на части путей к выходу, а с грязными старшими половинами
+	// регистров каждая SSE-инструкция вызывающего кода замедляется в разы
+	_mm256_zeroupper();
+	return lanes[0] + lanes[1] + lanes[2] + lanes[3] + SumRatingsScalar(ratings + i, count - i);
+}
+
+#endif
+
+} // namespace
+
+RatingSum& RatingSum::operator+=(const RatingSum& other) {
+	sum += other.sum;
+	count += other.count;
+	return *this;
+}
+
+int RatingSum::GetAverage() const {
+	if (count == 0) {
+		return 0;
+	}
+	return static_cast<int>(sum / static_cast<int64_t>(count));
+}
+
+int64_t SumRatings(const int* ratings, size_t count) {
+#ifdef RATING_AGGREGATOR_X86
+	static const bool has_avx2 = __builtin_cpu_supports("avx2");
+	// короче одного блока AVX2 — без перехода к 256-битным регистрам
+	return has_avx2 && count >= 8 ? SumRatingsAvx2(ratings, count) : SumRatingsSse(ratings, count);
+#else
+	return SumRatingsScalar(ratings, count);
+#endif
+}
+
+RatingSum AggregateRatings(const std::vector<int>& ratings) {
+	return AggregateRatings(std::execution::seq, ratings);
+}
+
+RatingSum AggregateRatings(std::execution::sequenced_policy, const std::vector<int>& ratings) {
+	return {SumRatings(ratings.data(), ratings.size()), ratings.size()};
+}
+
+RatingSum AggregateRatings(std::execution::parallel_policy, const std::vector<int>& ratings) {
+	if (ratings.size() < PARALLEL_RATING_THRESHOLD) {
+		return AggregateRatings(std::execution::seq, ratings);
+	}
+	std::vector<size_t> block_begins((ratings.size() + RATING_BLOCK_SIZE - 1) / RATING_BLOCK_SIZE);
+	for (size_t i = 0; i < block_begins.size(); ++i) {
+		block_begins[i] = i * RATING_BLOCK_SIZE;
+	}
+	const int64_t sum = std::transform_reduce(std::execution::par, block_begins.begin(), block_begins.end(), int64_t{0}, std::plus<>(),
+		[&ratings](size_t begin) {
+			return SumRatings(ratings.data() + begin, std::min(RATING_BLOCK_SIZE, ratings.size() - begin));
+		});
+	return {sum, ratings.size()};
+}
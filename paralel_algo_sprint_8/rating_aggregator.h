@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <execution>
+#include <vector>
+
+// с такого числа оценок сумма считается параллельно по блокам
+const size_t PARALLEL_RATING_THRESHOLD = 1 << 16;
+
+// Сумма и число оценок документа. Сумма 64-битная: миллионы оценок int не переполняют её,
+// поэтому оценки можно досылать частями, не пересчитывая уже полученные
+struct RatingSum {
+	int64_t sum = 0;
+	uint64_t count = 0;
+
+	RatingSum& operator+=(const RatingSum& other);
+	// среднее с отбрасыванием дробной части, 0 без оценок
+	int GetAverage() const;
+};
+
+// SIMD-суммирование с 64-битным накоплением; AVX2, если его поддерживает процессор
+int64_t SumRatings(const int* ratings, size_t count);
+
+RatingSum AggregateRatings(const std::vector<int>& ratings);
+RatingSum AggregateRatings(std::execution::sequenced_policy, const std::vector<int>& ratings);
+// блоки суммируются параллельно, короче PARALLEL_RATING_THRESHOLD — последовательно
+RatingSum AggregateRatings(std::execution::parallel_policy, const std::vector<int>& ratings);
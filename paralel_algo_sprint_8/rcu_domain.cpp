@@ -0,0 +1,39 @@
+#include "rcu_domain.h"
+#include <thread>
+
+RcuDomain::ReadGuard::ReadGuard(const RcuDomain& domain) {
+	const ReaderSlot& slot = domain.slots_[GetThreadSlot()];
+	while (true) {
+		const uint64_t epoch = domain.epoch_.load(std::memory_order_seq_cst);
+		counter_ = &slot.counters[epoch % 2];
+		// отметка и смена эпохи в Synchronize — seq_cst-операции одного полного порядка:
+		// либо писатель прочтёт отметку, либо читатель ниже — новую эпоху
+		counter_->fetch_add(1, std::memory_order_seq_cst);
+		// эпоха не сменилась после отметки — писатель увидит этого читателя
+		if (domain.epoch_.load(std::memory_order_seq_cst) == epoch) {
+			return;
+		}
+		counter_->fetch_sub(1, std::memory_order_release);
+	}
+}
+
+RcuDomain::ReadGuard::~ReadGuard() {
+	counter_->fetch_sub(1, std::memory_order_release);
+}
+
+void RcuDomain::Synchronize() {
+	// RMW вместо пары load/store: seq_cst-чтения счётчиков ниже не обгонят смену эпохи
+	const uint64_t epoch = epoch_.fetch_add(1, std::memory_order_seq_cst);
+	// новые читатели отмечаются в другом счётчике; читатели прошлой эпохи вышли в прошлый вызов
+	for (const ReaderSlot& slot : slots_) {
+		while (slot.counters[epoch % 2].load(std::memory_order_seq_cst) != 0) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+size_t RcuDomain::GetThreadSlot() {
+	static std::atomic<size_t> next_slot{0};
+	thread_local const size_t slot = next_slot.fetch_add(1, std::memory_order_relaxed) % SLOT_COUNT;
+	return slot;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Эпохи read-copy-update. Читатель отмечается в счётчике текущей эпохи — одно атомарное
+// сложение без блокировок и ожидания писателя. Писатель, заменив опубликованный указатель,
+// вызывает Synchronize: она переключает эпоху и ждёт, пока не выйдут читатели старой,
+// после чего прежнюю версию можно освобождать. Synchronize вызывает один писатель за раз
+class RcuDomain {
+public:
+	class ReadGuard {
+	public:
+		explicit ReadGuard(const RcuDomain& domain);
+		ReadGuard(const ReadGuard&) = delete;
+		ReadGuard& operator=(const ReadGuard&) = delete;
+		~ReadGuard();
+
+	private:
+		std::atomic<int64_t>* counter_;
+	};
+
+	RcuDomain() = default;
+	RcuDomain(const RcuDomain&) = delete;
+	RcuDomain& operator=(const RcuDomain&) = delete;
+
+	void Synchronize();
+
+private:
+	// потоки разнесены по слотам, чтобы читатели не писали в одну строку кэша
+	static const size_t SLOT_COUNT = 64;
+
+	struct alignas(64) ReaderSlot {
+		// читатели в эпохах с чётным и нечётным номером
+		mutable std::array<std::atomic<int64_t>, 2> counters{};
+	};
+
+	std::array<ReaderSlot, SLOT_COUNT> slots_;
+	std::atomic<uint64_t> epoch_{0};
+
+	static size_t GetThreadSlot();
+};
@@ -1,26 +1,195 @@
 #include "remove_duplicates.h"
+#include "profiler.h"
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <execution>
+#include <functional>
+#include <stdexcept>
+#include <unordered_map>
 
-void RemoveDuplicates(SearchServer& search_server) {
-	std::set<std::set<std::string>> words_set;
-	std::vector<int> remove_documents;
+namespace {
 
-	for (auto document : search_server) {
-		std::set<std::string> document_words_set;
-		auto word_freq = search_server.GetWordFrequencies(document);
-		std::transform(word_freq.begin(), word_freq.end(), std::inserter(document_words_set, document_words_set.begin()),
-		[](auto pair){
-			return pair.first;
-		});
-		if (words_set.count(document_words_set)) {
-			remove_documents.emplace_back(document);
+const size_t MIN_HASH_COUNT = 128;
+
+uint64_t Mix(uint64_t value) {
+	// splitmix64
+	value += 0x9E3779B97F4A7C15ull;
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+	return value ^ (value >> 31);
+}
+
+using WordFrequencies = SearchServer::WordFrequencies;
+
+// 128-битный отпечаток набора слов: сумма хэшей не зависит от порядка слов.
+// Слова сравниваются по term_id, он у всех документов одного сервера общий
+struct Fingerprint {
+	uint64_t low = 0;
+	uint64_t high = 0;
+
+	bool operator==(const Fingerprint& other) const {
+		return low == other.low && high == other.high;
+	}
+};
+
+struct FingerprintHasher {
+	size_t operator()(const Fingerprint& fingerprint) const {
+		return fingerprint.low ^ (fingerprint.high * 0x9E3779B97F4A7C15ull);
+	}
+};
+
+Fingerprint ComputeFingerprint(const WordFrequencies& word_freqs) {
+	Fingerprint fingerprint;
+	for (size_t i = 0; i < word_freqs.size(); ++i) {
+		const uint64_t term_id = word_freqs[i].term_id;
+		fingerprint.low += Mix(term_id);
+		fingerprint.high += Mix(term_id ^ 0xD1B54A32D192ED03ull);
+	}
+	return fingerprint;
+}
+
+bool HaveSameWords(const WordFrequencies& lhs, const WordFrequencies& rhs) {
+	if (lhs.size() != rhs.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < lhs.size(); ++i) {
+		if (lhs[i].term_id != rhs[i].term_id) {
+			return false;
+		}
+	}
+	return true;
+}
+
+using MinHashSignature = std::array<uint64_t, MIN_HASH_COUNT>;
+
+MinHashSignature ComputeMinHashSignature(const WordFrequencies& word_freqs) {
+	MinHashSignature signature;
+	signature.fill(UINT64_MAX);
+	for (size_t word = 0; word < word_freqs.size(); ++word) {
+		const uint64_t word_hash = Mix(word_freqs[word].term_id);
+		for (size_t i = 0; i < MIN_HASH_COUNT; ++i) {
+			signature[i] = std::min(signature[i], Mix(word_hash ^ (i * 0xD6E8FEB86659FD93ull)));
+		}
+	}
+	return signature;
+}
+
+double ComputeJaccard(const WordFrequencies& lhs, const WordFrequencies& rhs) {
+	if (lhs.empty() && rhs.empty()) {
+		return 1.0;
+	}
+	// прямой индекс отсортирован по term_id
+	size_t common = 0;
+	size_t lhs_index = 0;
+	size_t rhs_index = 0;
+	while (lhs_index < lhs.size() && rhs_index < rhs.size()) {
+		if (lhs[lhs_index].term_id < rhs[rhs_index].term_id) {
+			++lhs_index;
+		} else if (rhs[rhs_index].term_id < lhs[lhs_index].term_id) {
+			++rhs_index;
+		} else {
+			++common;
+			++lhs_index;
+			++rhs_index;
 		}
-		else {
-			words_set.emplace(document_words_set);
+	}
+	return common * 1.0 / (lhs.size() + rhs.size() - common);
+}
+
+// строк в полосе LSH: наибольшее r, при котором порог срабатывания (1/b)^(1/r) не выше jaccard_threshold
+size_t SelectBandRows(double jaccard_threshold) {
+	size_t band_rows = 1;
+	for (size_t rows = 2; rows <= MIN_HASH_COUNT / 2; rows *= 2) {
+		const double band_count = MIN_HASH_COUNT / rows;
+		if (std::pow(1.0 / band_count, 1.0 / rows) <= jaccard_threshold) {
+			band_rows = rows;
 		}
 	}
-	for (auto document : remove_documents) {
-		search_server.RemoveDocument(document);
+	return band_rows;
+}
 
+void RemoveFoundDuplicates(SearchServer& search_server, const std::vector<int>& duplicates) {
+	search_server.RemoveDocuments(std::execution::par, duplicates);
+	for (auto document : duplicates) {
 		std::cout << "Found duplicate document id " << document << std::endl;
 	}
-}
\ No newline at end of file
+}
+
+} // namespace
+
+void RemoveDuplicates(SearchServer& search_server) {
+	PROFILE_SCOPE("RemoveDuplicates");
+	const std::vector<int> document_ids(search_server.begin(), search_server.end());
+	std::vector<Fingerprint> fingerprints(document_ids.size());
+	std::transform(std::execution::par, document_ids.begin(), document_ids.end(), fingerprints.begin(),
+		[&search_server](int document_id) {
+			return ComputeFingerprint(search_server.GetWordFrequencies(document_id));
+		});
+
+	// документы-представители с данным отпечатком; коллизии проверяются сравнением слов
+	std::unordered_map<Fingerprint, std::vector<int>, FingerprintHasher> originals;
+	std::vector<int> remove_documents;
+	for (size_t i = 0; i < document_ids.size(); ++i) {
+		const int document = document_ids[i];
+		auto& candidates = originals[fingerprints[i]];
+		const auto word_freqs = search_server.GetWordFrequencies(document);
+		const bool is_duplicate = std::any_of(candidates.begin(), candidates.end(), [&](int original) {
+			return HaveSameWords(search_server.GetWordFrequencies(original), word_freqs);
+		});
+		if (is_duplicate) {
+			remove_documents.push_back(document);
+		} else {
+			candidates.push_back(document);
+		}
+	}
+	RemoveFoundDuplicates(search_server, remove_documents);
+}
+
+void RemoveNearDuplicates(SearchServer& search_server, double jaccard_threshold) {
+	PROFILE_SCOPE("RemoveNearDuplicates");
+	// отрицание сравнений отсекает и NaN
+	if (!(jaccard_threshold > 0.0 && jaccard_threshold <= 1.0)) {
+		throw std::invalid_argument("Invalid jaccard_threshold");
+	}
+	const std::vector<int> document_ids(search_server.begin(), search_server.end());
+	std::vector<MinHashSignature> signatures(document_ids.size());
+	std::transform(std::execution::par, document_ids.begin(), document_ids.end(), signatures.begin(),
+		[&search_server](int document_id) {
+			return ComputeMinHashSignature(search_server.GetWordFrequencies(document_id));
+		});
+
+	const size_t band_rows = SelectBandRows(jaccard_threshold);
+	const size_t band_count = MIN_HASH_COUNT / band_rows;
+	// корзины LSH: хэш полосы -> оставленные документы
+	std::unordered_map<uint64_t, std::vector<int>> buckets;
+	std::vector<uint64_t> band_hashes(band_count);
+	std::vector<int> remove_documents;
+	for (size_t i = 0; i < document_ids.size(); ++i) {
+		const int document = document_ids[i];
+		const auto word_freqs = search_server.GetWordFrequencies(document);
+		bool is_duplicate = false;
+		for (size_t band = 0; band < band_count && !is_duplicate; ++band) {
+			uint64_t band_hash = Mix(band);
+			for (size_t row = 0; row < band_rows; ++row) {
+				band_hash = Mix(band_hash ^ signatures[i][band * band_rows + row]);
+			}
+			band_hashes[band] = band_hash;
+			const auto it = buckets.find(band_hash);
+			if (it == buckets.end()) {
+				continue;
+			}
+			is_duplicate = std::any_of(it->second.begin(), it->second.end(), [&](int original) {
+				return ComputeJaccard(search_server.GetWordFrequencies(original), word_freqs) >= jaccard_threshold;
+			});
+		}
+		if (is_duplicate) {
+			remove_documents.push_back(document);
+			continue;
+		}
+		for (const uint64_t band_hash : band_hashes) {
+			buckets[band_hash].push_back(document);
+		}
+	}
+	RemoveFoundDuplicates(search_server, remove_documents);
+}
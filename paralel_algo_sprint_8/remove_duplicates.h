@@ -4,4 +4,8 @@
 #include <algorithm>
 #include <iterator>
 
+// удаляет документы с тем же набором слов, что у документа с меньшим id
 void RemoveDuplicates(SearchServer& search_server);
+// удаляет документы, у которых коэффициент Жаккара наборов слов с каким-либо
+// оставленным документом с меньшим id не ниже jaccard_threshold (MinHash + LSH)
+void RemoveNearDuplicates(SearchServer& search_server, double jaccard_threshold);
@@ -1,6 +1,60 @@
 #include "request_queue.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
 
-RequestQueue::RequestQueue(const SearchServer& search_server) : server_(search_server){
+namespace {
+
+const uint16_t EMPTY_RESULT_FLAG = 0x8000;
+// разбор слова счётчика корзины времени
+const int COUNTER_TAG_SHIFT = 24;
+const uint64_t COUNTER_VALUE_MASK = (uint64_t(1) << COUNTER_TAG_SHIFT) - 1;
+
+int64_t GetCounterEpoch(uint64_t counter) {
+	return static_cast<int64_t>(counter >> COUNTER_TAG_SHIFT) - 1;
+}
+
+// прибавляет запрос интервала epoch; счётчик более раннего интервала заменяется, более позднего не трогается.
+// CAS не удаётся, только если другой писатель успел изменить слово, поэтому вызов никого не ждёт
+void IncrementCounter(std::atomic<uint64_t>& counter, int64_t epoch) {
+	const uint64_t epoch_tag = static_cast<uint64_t>(epoch + 1) << COUNTER_TAG_SHIFT;
+	uint64_t value = counter.load(std::memory_order_relaxed);
+	while (true) {
+		const int64_t counter_epoch = GetCounterEpoch(value);
+		uint64_t next_value = epoch_tag | 1;
+		if (counter_epoch > epoch) {
+			// корзина уже отдана более позднему интервалу: запрос выпал из окна
+			return;
+		}
+		if (counter_epoch == epoch) {
+			// переполненный счётчик насыщается, а не залезает в номер интервала
+			if ((value & COUNTER_VALUE_MASK) == COUNTER_VALUE_MASK) {
+				return;
+			}
+			next_value = value + 1;
+		}
+		if (counter.compare_exchange_weak(value, next_value, std::memory_order_relaxed)) {
+			return;
+		}
+	}
+}
+
+} // namespace
+
+RequestQueue::RequestQueue(const SearchServer& search_server, size_t window_requests)
+: server_(search_server)
+, slots_(std::max<size_t>(window_requests, 1)) {
+}
+
+RequestQueue::RequestQueue(const SearchServer& search_server, Clock::duration window_time)
+: server_(search_server)
+, start_time_(Clock::now())
+, bucket_width_(window_time / TIME_BUCKET_COUNT)
+, time_buckets_(TIME_BUCKET_COUNT) {
+	using namespace std::string_literals;
+	if (bucket_width_ < MIN_BUCKET_WIDTH) {
+		throw std::invalid_argument("Request window is shorter than "s + std::to_string(TIME_BUCKET_COUNT * MIN_BUCKET_WIDTH / std::chrono::milliseconds(1)) + " ms"s);
+	}
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
@@ -14,5 +68,104 @@ std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query)
 }
 
 int RequestQueue::GetNoResultRequests() const {
+	if (time_buckets_.empty()) {
+		return counters_.empty.load(std::memory_order_relaxed);
+	}
+	const int64_t current_epoch = GetEpoch(Clock::now());
+	int empty_count = 0;
+	for (const TimeBucket& bucket : time_buckets_) {
+		empty_count += static_cast<int>(LoadWindowCount(bucket.empty, current_epoch));
+	}
 	return empty_count;
-}
\ No newline at end of file
+}
+
+int RequestQueue::GetRequestCount() const {
+	if (time_buckets_.empty()) {
+		return counters_.requests.load(std::memory_order_relaxed);
+	}
+	const int64_t current_epoch = GetEpoch(Clock::now());
+	int request_count = 0;
+	for (const TimeBucket& bucket : time_buckets_) {
+		request_count += static_cast<int>(LoadWindowCount(bucket.requests, current_epoch));
+	}
+	return request_count;
+}
+
+double RequestQueue::GetNoResultRate() const {
+	const int request_count = GetRequestCount();
+	return request_count == 0 ? 0.0 : GetNoResultRequests() * 1.0 / request_count;
+}
+
+RequestQueue::Clock::duration RequestQueue::GetLatencyPercentile(double percentile) const {
+	std::array<uint64_t, LATENCY_BUCKET_COUNT> latencies{};
+	if (time_buckets_.empty()) {
+		for (size_t i = 0; i < LATENCY_BUCKET_COUNT; ++i) {
+			latencies[i] = counters_.latencies[i].load(std::memory_order_relaxed);
+		}
+	} else {
+		const int64_t current_epoch = GetEpoch(Clock::now());
+		for (const TimeBucket& bucket : time_buckets_) {
+			for (size_t i = 0; i < LATENCY_BUCKET_COUNT; ++i) {
+				latencies[i] += LoadWindowCount(bucket.latencies[i], current_epoch);
+			}
+		}
+	}
+
+	uint64_t total = 0;
+	for (const uint64_t count : latencies) {
+		total += count;
+	}
+	if (total == 0) {
+		return Clock::duration::zero();
+	}
+	const uint64_t rank = std::max<uint64_t>(std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * total), 1);
+	uint64_t seen = 0;
+	for (size_t i = 0; i < LATENCY_BUCKET_COUNT; ++i) {
+		seen += latencies[i];
+		if (seen >= rank) {
+			return GetLatencyBucketUpperBound(i);
+		}
+	}
+	return GetLatencyBucketUpperBound(LATENCY_BUCKET_COUNT - 1);
+}
+
+int64_t RequestQueue::GetEpoch(Clock::time_point time) const {
+	return std::max<Clock::duration>(time - start_time_, Clock::duration::zero()) / bucket_width_;
+}
+
+uint64_t RequestQueue::LoadWindowCount(const std::atomic<uint64_t>& counter, int64_t current_epoch) const {
+	const uint64_t value = counter.load(std::memory_order_relaxed);
+	const int64_t epoch = GetCounterEpoch(value);
+	if (epoch < 0 || epoch > current_epoch || current_epoch - epoch >= static_cast<int64_t>(TIME_BUCKET_COUNT)) {
+		return 0;
+	}
+	return value & COUNTER_VALUE_MASK;
+}
+
+void RequestQueue::Record(Clock::time_point finish_time, bool is_empty, Clock::duration latency) {
+	const size_t latency_bucket = GetLatencyBucket(latency);
+	if (time_buckets_.empty()) {
+		const uint16_t value = (is_empty ? EMPTY_RESULT_FLAG : 0) | (latency_bucket + 1);
+		const uint64_t slot = next_slot_.fetch_add(1, std::memory_order_relaxed) % slots_.size();
+		counters_.requests.fetch_add(1, std::memory_order_relaxed);
+		counters_.empty.fetch_add(is_empty ? 1 : 0, std::memory_order_relaxed);
+		counters_.latencies[latency_bucket].fetch_add(1, std::memory_order_relaxed);
+		// acq_rel: тот, кто вытеснит эту запись, вычтет её счётчики только после наших добавлений
+		const uint16_t old_value = slots_[slot].exchange(value, std::memory_order_acq_rel);
+		// вытесненный из окна запрос
+		if (old_value != 0) {
+			counters_.requests.fetch_sub(1, std::memory_order_relaxed);
+			counters_.empty.fetch_sub((old_value & EMPTY_RESULT_FLAG) ? 1 : 0, std::memory_order_relaxed);
+			counters_.latencies[(old_value & ~EMPTY_RESULT_FLAG) - 1].fetch_sub(1, std::memory_order_relaxed);
+		}
+		return;
+	}
+
+	const int64_t epoch = GetEpoch(finish_time);
+	TimeBucket& bucket = time_buckets_[epoch % TIME_BUCKET_COUNT];
+	IncrementCounter(bucket.requests, epoch);
+	if (is_empty) {
+		IncrementCounter(bucket.empty, epoch);
+	}
+	IncrementCounter(bucket.latencies[latency_bucket], epoch);
+}
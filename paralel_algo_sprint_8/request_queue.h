@@ -1,43 +1,71 @@
 #pragma once
-#include <deque>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <vector>
+#include "search_metrics.h"
 #include "search_server.h"
 
+// Статистика запросов в скользящем окне: последние N запросов или запросы за последнее время.
+// Хранятся только счётчики, результаты поиска не копируются; AddFindRequest можно
+// вызывать из многих потоков одновременно, запись не берёт мьютексов и никого не ждёт. В окне по времени
+// каждый счётчик корзины помечен номером своего интервала: писатель нового интервала заменяет
+// устаревшее значение одной CAS, читатель пропускает счётчики вне окна
 class RequestQueue {
 public:
-	explicit RequestQueue(const SearchServer& search_server);
+	using Clock = std::chrono::steady_clock;
+
+	explicit RequestQueue(const SearchServer& search_server, size_t window_requests = sec_in_day_);
+	// окно короче 60 мс (корзины уже MIN_BUCKET_WIDTH) отвергается: std::invalid_argument
+	RequestQueue(const SearchServer& search_server, Clock::duration window_time);
 	template <typename DocumentPredicate>
 	std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate);
 	std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
 	std::vector<Document> AddFindRequest(const std::string& raw_query);
 	int GetNoResultRequests() const;
+	int GetRequestCount() const;
+	double GetNoResultRate() const;
+	// верхняя граница интервала гистограммы, в который попал перцентиль (0..100)
+	Clock::duration GetLatencyPercentile(double percentile) const;
 private:
-	struct QueryResult {
-		std::vector<Document> found_documents;
-		bool empty_docs = false;
-	};
-	std::deque<QueryResult> requests_;
+	static constexpr size_t TIME_BUCKET_COUNT = 60;
+	// корзины уже миллисекунды не дают: номер интервала занимает в слове счётчика 40 бит
+	static constexpr Clock::duration MIN_BUCKET_WIDTH = std::chrono::milliseconds(1);
 	const static int sec_in_day_ = 1440;
+
+	struct WindowCounters {
+		std::atomic<int> requests{0};
+		std::atomic<int> empty{0};
+		std::array<std::atomic<uint32_t>, LATENCY_BUCKET_COUNT> latencies{};
+	};
+	// в каждом слове (номер интервала + 1) << 24 | счётчик; 0 — в счётчик ещё не писали
+	struct TimeBucket {
+		std::atomic<uint64_t> requests{0};
+		std::atomic<uint64_t> empty{0};
+		std::array<std::atomic<uint64_t>, LATENCY_BUCKET_COUNT> latencies{};
+	};
+
 	const SearchServer& server_;
-	uint empty_count = 0;
+	// окно по числу запросов: в ячейке номер интервала задержки + 1 и старший бит «пустой ответ»
+	std::vector<std::atomic<uint16_t>> slots_;
+	std::atomic<uint64_t> next_slot_{0};
+	WindowCounters counters_;
+	// окно по времени: корзины шириной window_time / TIME_BUCKET_COUNT, интервалы считаются от создания очереди
+	Clock::time_point start_time_{};
+	Clock::duration bucket_width_{};
+	std::vector<TimeBucket> time_buckets_;
+
+	int64_t GetEpoch(Clock::time_point time) const;
+	uint64_t LoadWindowCount(const std::atomic<uint64_t>& counter, int64_t current_epoch) const;
+	void Record(Clock::time_point finish_time, bool is_empty, Clock::duration latency);
 };
 
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
-	if(!requests_.empty()) {
-		while(requests_.size() >= sec_in_day_){
-			if(requests_.front().empty_docs) {
-				--empty_count;
-			}
-			requests_.pop_front();
-		}
-	}
-	QueryResult result;
-	result.found_documents = server_.FindTopDocuments(raw_query, document_predicate);
-	if(result.found_documents.empty()) {
-		++empty_count;
-		result.empty_docs = true;
-	}
-	requests_.push_back(result);
-	return result.found_documents;
-}
\ No newline at end of file
+	const auto start_time = Clock::now();
+	auto found_documents = server_.FindTopDocuments(raw_query, document_predicate);
+	const auto finish_time = Clock::now();
+	Record(finish_time, found_documents.empty(), finish_time - start_time);
+	return found_documents;
+}
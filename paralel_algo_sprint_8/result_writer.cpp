@@ -0,0 +1,263 @@
+#include "result_writer.h"
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+using namespace std::string_literals;
+
+namespace {
+
+const std::string_view BINARY_MAGIC = "SRES";
+const char BINARY_DOCUMENT_TAG = 'D';
+const char BINARY_MATCH_TAG = 'M';
+// длиннее не бывает ни число, ни запись документа в тексте или JSON
+const size_t MAX_NUMBER_SIZE = 32;
+const size_t MAX_DOCUMENT_RECORD_SIZE = 128;
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+const char* GetStatusName(DocumentStatus status) {
+	switch (status) {
+	case DocumentStatus::ACTUAL:
+		return "ACTUAL";
+	case DocumentStatus::IRRELEVANT:
+		return "IRRELEVANT";
+	case DocumentStatus::BANNED:
+		return "BANNED";
+	case DocumentStatus::REMOVED:
+		return "REMOVED";
+	}
+	return "UNKNOWN";
+}
+
+uint64_t ReadLittleEndian(std::string_view& data, size_t byte_count) {
+	if (data.size() < byte_count) {
+		throw std::invalid_argument("Truncated binary results"s);
+	}
+	uint64_t value = 0;
+	for (size_t i = 0; i < byte_count; ++i) {
+		value |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+	}
+	data.remove_prefix(byte_count);
+	return value;
+}
+
+} // namespace
+
+ResultWriter::ResultWriter(int fd, ResultFormat format, size_t buffer_size)
+: fd_(fd)
+, format_(format)
+, buffer_(std::max(buffer_size, MAX_DOCUMENT_RECORD_SIZE)) {
+	if (format_ == ResultFormat::BINARY) {
+		Append(BINARY_MAGIC);
+	}
+}
+
+ResultWriter::~ResultWriter() {
+	try {
+		Flush();
+	} catch (const std::exception&) {
+	}
+}
+
+void ResultWriter::Write(const Document& document) {
+	Reserve(MAX_DOCUMENT_RECORD_SIZE);
+	switch (format_) {
+	case ResultFormat::TEXT:
+		// форматирование как у operator<< с точностью потока по умолчанию
+		Append("{ document_id = ");
+		AppendInt(document.id);
+		Append(", relevance = ");
+		AppendDouble(document.relevance, false);
+		Append(", rating = ");
+		AppendInt(document.rating);
+		Append(" }\n");
+		break;
+	case ResultFormat::JSON:
+		Append("{\"document_id\":");
+		AppendInt(document.id);
+		Append(",\"relevance\":");
+		AppendDouble(document.relevance, true);
+		Append(",\"rating\":");
+		AppendInt(document.rating);
+		Append("}\n");
+		break;
+	case ResultFormat::BINARY:
+		Append(std::string_view(&BINARY_DOCUMENT_TAG, 1));
+		AppendLittleEndian(static_cast<uint32_t>(document.id), 4);
+		uint64_t relevance_bits;
+		std::memcpy(&relevance_bits, &document.relevance, sizeof(relevance_bits));
+		AppendLittleEndian(relevance_bits, 8);
+		AppendLittleEndian(static_cast<uint32_t>(document.rating), 4);
+		break;
+	}
+}
+
+void ResultWriter::Write(const std::vector<Document>& documents) {
+	for (const Document& document : documents) {
+		Write(document);
+	}
+}
+
+void ResultWriter::WriteMatch(int document_id, const std::vector<std::string_view>& words, DocumentStatus status) {
+	size_t words_size = 0;
+	for (const std::string_view word : words) {
+		// кавычки и запятая JSON или длина в двоичном формате; \u00XX увеличивает слово до шести раз
+		words_size += 6 * word.size() + 4;
+	}
+	Reserve(MAX_DOCUMENT_RECORD_SIZE + words_size);
+	switch (format_) {
+	case ResultFormat::TEXT:
+		Append("{ document_id = ");
+		AppendInt(document_id);
+		Append(", status = ");
+		AppendInt(static_cast<int>(status));
+		Append(", words =");
+		for (const std::string_view word : words) {
+			Append(" ");
+			Append(word);
+		}
+		Append("}\n");
+		break;
+	case ResultFormat::JSON:
+		Append("{\"document_id\":");
+		AppendInt(document_id);
+		Append(",\"status\":\"");
+		Append(GetStatusName(status));
+		Append("\",\"words\":[");
+		for (size_t i = 0; i < words.size(); ++i) {
+			if (i > 0) {
+				Append(",");
+			}
+			AppendJsonString(words[i]);
+		}
+		Append("]}\n");
+		break;
+	case ResultFormat::BINARY:
+		Append(std::string_view(&BINARY_MATCH_TAG, 1));
+		AppendLittleEndian(static_cast<uint32_t>(document_id), 4);
+		AppendLittleEndian(static_cast<uint8_t>(status), 1);
+		AppendLittleEndian(words.size(), 4);
+		for (const std::string_view word : words) {
+			AppendLittleEndian(word.size(), 4);
+			Append(word);
+		}
+		break;
+	}
+}
+
+void ResultWriter::Flush() {
+	size_t offset = 0;
+	while (offset < size_) {
+		const ssize_t written = write(fd_, buffer_.data() + offset, size_ - offset);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			// неотправленное остаётся в буфере
+			std::memmove(buffer_.data(), buffer_.data() + offset, size_ - offset);
+			size_ -= offset;
+			throw std::runtime_error("Write error: "s + std::strerror(errno));
+		}
+		offset += written;
+		written_bytes_ += written;
+	}
+	size_ = 0;
+}
+
+size_t ResultWriter::GetWrittenBytes() const {
+	return written_bytes_;
+}
+
+char* ResultWriter::Reserve(size_t byte_count) {
+	if (size_ + byte_count > buffer_.size()) {
+		Flush();
+		if (byte_count > buffer_.size()) {
+			buffer_.resize(byte_count);
+		}
+	}
+	return buffer_.data() + size_;
+}
+
+void ResultWriter::Append(std::string_view text) {
+	std::memcpy(Reserve(text.size()), text.data(), text.size());
+	size_ += text.size();
+}
+
+void ResultWriter::AppendInt(long long value) {
+	char* const begin = Reserve(MAX_NUMBER_SIZE);
+	size_ = std::to_chars(begin, begin + MAX_NUMBER_SIZE, value).ptr - buffer_.data();
+}
+
+void ResultWriter::AppendDouble(double value, bool shortest) {
+	if (shortest && !std::isfinite(value)) {
+		// в JSON нет бесконечностей и NaN
+		Append("null");
+		return;
+	}
+	char* const begin = Reserve(MAX_NUMBER_SIZE);
+	// general с точностью 6 совпадает с выводом std::ostream по умолчанию
+	const auto result = shortest ? std::to_chars(begin, begin + MAX_NUMBER_SIZE, value)
+		: std::to_chars(begin, begin + MAX_NUMBER_SIZE, value, std::chars_format::general, 6);
+	size_ = result.ptr - buffer_.data();
+}
+
+void ResultWriter::AppendJsonString(std::string_view text) {
+	Append("\"");
+	for (const char c : text) {
+		if (c == '"' || c == '\\') {
+			const char escaped[] = {'\\', c};
+			Append(std::string_view(escaped, 2));
+		} else if (static_cast<unsigned char>(c) < 0x20) {
+			// управляющие символы в строках JSON записываются только как \u00XX
+			const char escaped[] = {'\\', 'u', '0', '0', HEX_DIGITS[c >> 4], HEX_DIGITS[c & 0xf]};
+			Append(std::string_view(escaped, sizeof(escaped)));
+		} else {
+			Append(std::string_view(&c, 1));
+		}
+	}
+	Append("\"");
+}
+
+void ResultWriter::AppendLittleEndian(uint64_t value, size_t byte_count) {
+	char* const begin = Reserve(byte_count);
+	for (size_t i = 0; i < byte_count; ++i) {
+		begin[i] = static_cast<char>(value >> (8 * i));
+	}
+	size_ += byte_count;
+}
+
+std::vector<Document> ReadBinaryDocuments(std::string_view data) {
+	if (data.substr(0, BINARY_MAGIC.size()) != BINARY_MAGIC) {
+		throw std::invalid_argument("Not binary results"s);
+	}
+	data.remove_prefix(BINARY_MAGIC.size());
+	std::vector<Document> documents;
+	while (!data.empty()) {
+		const char tag = data[0];
+		data.remove_prefix(1);
+		const int document_id = static_cast<int32_t>(ReadLittleEndian(data, 4));
+		if (tag == BINARY_DOCUMENT_TAG) {
+			const uint64_t relevance_bits = ReadLittleEndian(data, 8);
+			double relevance;
+			std::memcpy(&relevance, &relevance_bits, sizeof(relevance));
+			documents.emplace_back(document_id, relevance, static_cast<int32_t>(ReadLittleEndian(data, 4)));
+		} else if (tag == BINARY_MATCH_TAG) {
+			ReadLittleEndian(data, 1);
+			for (uint64_t word_count = ReadLittleEndian(data, 4); word_count > 0; --word_count) {
+				const uint64_t word_size = ReadLittleEndian(data, 4);
+				if (data.size() < word_size) {
+					throw std::invalid_argument("Truncated binary results"s);
+				}
+				data.remove_prefix(word_size);
+			}
+		} else {
+			throw std::invalid_argument("Unknown binary record "s + tag);
+		}
+	}
+	return documents;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "document.h"
+
+const size_t DEFAULT_RESULT_BUFFER_SIZE = 1 << 16;
+
+enum class ResultFormat {
+	// как PrintDocument и PrintMatchDocumentResult
+	TEXT,
+	// объект JSON на строку
+	JSON,
+	// Заголовок "SRES", затем записи little-endian:
+	// 'D', int32 id, float64 relevance, int32 rating — документ;
+	// 'M', int32 id, uint8 status, uint32 число слов, у каждого uint32 длина и байты — матчинг
+	BINARY,
+};
+
+// Буферизованный вывод результатов поиска в файловый дескриптор: числа форматируются
+// std::to_chars прямо в переиспользуемый буфер, заполненный буфер уходит одним write.
+// Ошибка записи — std::runtime_error
+class ResultWriter {
+public:
+	ResultWriter(int fd, ResultFormat format, size_t buffer_size = DEFAULT_RESULT_BUFFER_SIZE);
+	ResultWriter(const ResultWriter&) = delete;
+	ResultWriter& operator=(const ResultWriter&) = delete;
+	// дописывает остаток буфера; ошибки здесь не сообщаются, для них нужен явный Flush
+	~ResultWriter();
+
+	void Write(const Document& document);
+	// например, результат ProcessQueriesJoined
+	void Write(const std::vector<Document>& documents);
+	void WriteMatch(int document_id, const std::vector<std::string_view>& words, DocumentStatus status);
+	void Flush();
+
+	// всего передано в write
+	size_t GetWrittenBytes() const;
+
+private:
+	int fd_;
+	ResultFormat format_;
+	std::vector<char> buffer_;
+	size_t size_ = 0;
+	size_t written_bytes_ = 0;
+
+	// гарантирует место под byte_count байт
+	char* Reserve(size_t byte_count);
+	void Append(std::string_view text);
+	void AppendInt(long long value);
+	void AppendDouble(double value, bool shortest);
+	void AppendJsonString(std::string_view text);
+	void AppendLittleEndian(uint64_t value, size_t byte_count);
+};
+
+// документы из вывода ResultFormat::BINARY, записи матчинга пропускаются;
+// повреждённые данные — std::invalid_argument
+std::vector<Document> ReadBinaryDocuments(std::string_view data);
@@ -0,0 +1,182 @@
+#include "search_metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+// гистограммы одного потока: пишет только владелец, поэтому хватает load + store
+struct ThreadSearchMetrics {
+	std::array<std::array<std::atomic<uint64_t>, LATENCY_BUCKET_COUNT>, SEARCH_PHASE_COUNT> latencies{};
+	std::array<std::atomic<uint64_t>, SEARCH_PHASE_COUNT> latency_sums_ns{};
+	std::atomic<uint64_t> postings_scanned{0};
+	std::atomic<uint64_t> documents_scored{0};
+};
+
+void AddThreadMetrics(SearchMetricsSnapshot& snapshot, const ThreadSearchMetrics& metrics) {
+	for (size_t phase = 0; phase < SEARCH_PHASE_COUNT; ++phase) {
+		for (size_t bucket = 0; bucket < LATENCY_BUCKET_COUNT; ++bucket) {
+			snapshot.latencies[phase][bucket] += metrics.latencies[phase][bucket].load(std::memory_order_relaxed);
+		}
+		snapshot.latency_sums_ns[phase] += metrics.latency_sums_ns[phase].load(std::memory_order_relaxed);
+	}
+	snapshot.postings_scanned += metrics.postings_scanned.load(std::memory_order_relaxed);
+	snapshot.documents_scored += metrics.documents_scored.load(std::memory_order_relaxed);
+}
+
+// гистограммы живых потоков и сумма по завершившимся
+struct SearchMetricsRegistry {
+	std::mutex mutex;
+	std::vector<const ThreadSearchMetrics*> threads;
+	SearchMetricsSnapshot retired;
+};
+
+SearchMetricsRegistry& GetRegistry() {
+	static SearchMetricsRegistry registry;
+	return registry;
+}
+
+// при завершении потока переносит его гистограммы в общую сумму и освобождает их
+class ThreadMetricsOwner {
+public:
+	ThreadMetricsOwner() {
+		SearchMetricsRegistry& registry = GetRegistry();
+		std::lock_guard guard(registry.mutex);
+		registry.threads.push_back(&metrics_);
+	}
+
+	~ThreadMetricsOwner() {
+		SearchMetricsRegistry& registry = GetRegistry();
+		std::lock_guard guard(registry.mutex);
+		AddThreadMetrics(registry.retired, metrics_);
+		registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), &metrics_));
+	}
+
+	ThreadMetricsOwner(const ThreadMetricsOwner&) = delete;
+	ThreadMetricsOwner& operator=(const ThreadMetricsOwner&) = delete;
+
+	ThreadSearchMetrics& Get() {
+		return metrics_;
+	}
+
+private:
+	ThreadSearchMetrics metrics_;
+};
+
+ThreadSearchMetrics& GetThreadMetrics() {
+	thread_local ThreadMetricsOwner owner;
+	return owner.Get();
+}
+
+void Increment(std::atomic<uint64_t>& counter, uint64_t value) {
+	counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+} // namespace
+
+size_t GetLatencyBucket(std::chrono::steady_clock::duration latency) {
+	const uint64_t nanoseconds = std::max<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count(), 0);
+	if (nanoseconds < 4) {
+		return nanoseconds;
+	}
+	const int exponent = 63 - __builtin_clzll(nanoseconds);
+	const size_t sub_bucket = (nanoseconds >> (exponent - 2)) & 3;
+	return 4 + (exponent - 2) * 4 + sub_bucket;
+}
+
+std::chrono::steady_clock::duration GetLatencyBucketUpperBound(size_t bucket) {
+	if (bucket < 4) {
+		return std::chrono::nanoseconds(bucket);
+	}
+	const int exponent = (bucket - 4) / 4 + 2;
+	const uint64_t sub_bucket = (bucket - 4) % 4;
+	const uint64_t upper = exponent >= 62 ? INT64_MAX : ((4 + sub_bucket + 1) << (exponent - 2)) - 1;
+	return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(std::min<uint64_t>(upper, INT64_MAX)));
+}
+
+const char* GetSearchPhaseName(SearchPhase phase) {
+	switch (phase) {
+	case SearchPhase::PARSE:
+		return "parse";
+	case SearchPhase::POSTINGS_FETCH:
+		return "postings_fetch";
+	case SearchPhase::SCORING:
+		return "scoring";
+	case SearchPhase::FILTERING:
+		return "filtering";
+	case SearchPhase::TOP_K:
+		return "top_k";
+	case SearchPhase::TOTAL:
+		return "total";
+	}
+	return "unknown";
+}
+
+uint64_t SearchMetricsSnapshot::GetCount(SearchPhase phase) const {
+	const auto& histogram = latencies[static_cast<size_t>(phase)];
+	uint64_t count = 0;
+	for (const uint64_t bucket_count : histogram) {
+		count += bucket_count;
+	}
+	return count;
+}
+
+std::chrono::steady_clock::duration SearchMetricsSnapshot::GetPercentile(SearchPhase phase, double percentile) const {
+	const uint64_t total = GetCount(phase);
+	if (total == 0) {
+		return std::chrono::steady_clock::duration::zero();
+	}
+	const auto& histogram = latencies[static_cast<size_t>(phase)];
+	const uint64_t rank = std::max<uint64_t>(std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * total), 1);
+	uint64_t seen = 0;
+	for (size_t i = 0; i < LATENCY_BUCKET_COUNT; ++i) {
+		seen += histogram[i];
+		if (seen >= rank) {
+			return GetLatencyBucketUpperBound(i);
+		}
+	}
+	return GetLatencyBucketUpperBound(LATENCY_BUCKET_COUNT - 1);
+}
+
+void RecordSearchPhase(SearchPhase phase, std::chrono::steady_clock::duration latency) {
+	ThreadSearchMetrics& metrics = GetThreadMetrics();
+	const size_t index = static_cast<size_t>(phase);
+	Increment(metrics.latencies[index][GetLatencyBucket(latency)], 1);
+	Increment(metrics.latency_sums_ns[index], std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+}
+
+void AddSearchCounters(uint64_t postings_scanned, uint64_t documents_scored) {
+	ThreadSearchMetrics& metrics = GetThreadMetrics();
+	Increment(metrics.postings_scanned, postings_scanned);
+	Increment(metrics.documents_scored, documents_scored);
+}
+
+SearchMetricsSnapshot CollectSearchMetrics() {
+	SearchMetricsRegistry& registry = GetRegistry();
+	std::lock_guard guard(registry.mutex);
+	SearchMetricsSnapshot snapshot = registry.retired;
+	for (const ThreadSearchMetrics* metrics : registry.threads) {
+		AddThreadMetrics(snapshot, *metrics);
+	}
+	return snapshot;
+}
+
+void PrintSearchMetrics(std::ostream& out, const SearchMetricsSnapshot& snapshot) {
+	const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+	out << "# TYPE search_phase_latency_seconds summary\n";
+	for (size_t index = 0; index < SEARCH_PHASE_COUNT; ++index) {
+		const SearchPhase phase = static_cast<SearchPhase>(index);
+		const char* name = GetSearchPhaseName(phase);
+		for (const double quantile : quantiles) {
+			const auto latency = std::chrono::duration<double>(snapshot.GetPercentile(phase, quantile * 100));
+			out << "search_phase_latency_seconds{phase=\"" << name << "\",quantile=\"" << quantile << "\"} " << latency.count() << '\n';
+		}
+		out << "search_phase_latency_seconds_sum{phase=\"" << name << "\"} " << snapshot.latency_sums_ns[index] * 1e-9 << '\n';
+		out << "search_phase_latency_seconds_count{phase=\"" << name << "\"} " << snapshot.GetCount(phase) << '\n';
+	}
+	out << "# TYPE search_postings_scanned_total counter\n";
+	out << "search_postings_scanned_total " << snapshot.postings_scanned << '\n';
+	out << "# TYPE search_documents_scored_total counter\n";
+	out << "search_documents_scored_total " << snapshot.documents_scored << '\n';
+}
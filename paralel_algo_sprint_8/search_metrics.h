@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// Логарифмическая гистограмма задержек: степень двойки наносекунд делится на 4 интервала,
+// погрешность до 25%, 256 интервалов покрывают весь диапазон int64
+const size_t LATENCY_BUCKET_COUNT = 256;
+
+size_t GetLatencyBucket(std::chrono::steady_clock::duration latency);
+// верхняя граница интервала гистограммы
+std::chrono::steady_clock::duration GetLatencyBucketUpperBound(size_t bucket);
+
+// фазы FindTopDocuments
+enum class SearchPhase {
+	PARSE,
+	POSTINGS_FETCH,
+	SCORING,
+	FILTERING,
+	TOP_K,
+	TOTAL,
+};
+const size_t SEARCH_PHASE_COUNT = 6;
+
+const char* GetSearchPhaseName(SearchPhase phase);
+
+struct SearchMetricsSnapshot {
+	std::array<std::array<uint64_t, LATENCY_BUCKET_COUNT>, SEARCH_PHASE_COUNT> latencies{};
+	std::array<uint64_t, SEARCH_PHASE_COUNT> latency_sums_ns{};
+	uint64_t postings_scanned = 0;
+	uint64_t documents_scored = 0;
+
+	uint64_t GetCount(SearchPhase phase) const;
+	// percentile от 0 до 100
+	std::chrono::steady_clock::duration GetPercentile(SearchPhase phase, double percentile) const;
+};
+
+// Метрики пишутся в гистограммы потока без блокировок и атомарных RMW;
+// снимок суммирует гистограммы живых потоков и сумму по завершившимся, счётчики только растут.
+// Гистограммы потока освобождаются при его завершении
+void RecordSearchPhase(SearchPhase phase, std::chrono::steady_clock::duration latency);
+void AddSearchCounters(uint64_t postings_scanned, uint64_t documents_scored);
+SearchMetricsSnapshot CollectSearchMetrics();
+// текстовый формат Prometheus: summary по фазам и counter-ы
+void PrintSearchMetrics(std::ostream& out, const SearchMetricsSnapshot& snapshot);
+
+// засекает фазы подряд: каждая Mark записывает время с предыдущей отметки
+class SearchPhaseTimer {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	void Mark(SearchPhase phase) {
+		const auto now = Clock::now();
+		RecordSearchPhase(phase, now - last_time_);
+		last_time_ = now;
+	}
+
+	void Finish() {
+		last_time_ = Clock::now();
+		RecordSearchPhase(SearchPhase::TOTAL, last_time_ - start_time_);
+	}
+
+private:
+	const Clock::time_point start_time_ = Clock::now();
+	Clock::time_point last_time_ = start_time_;
+};
@@ -1,7 +1,133 @@
 #include "search_server.h"
+#include "profiler.h"
+#include <atomic>
+#include <charconv>
+#include <list>
+#include <tuple>
 #include <cmath>
 #include <string_view>
 
+namespace {
+
+// во сколько раз список группы должен быть длиннее кандидатов, чтобы искать кандидатов в нём поштучно
+const size_t REQUIRED_PROBE_RATIO = 16;
+
+double ParseBoost(const std::string_view text) {
+	// std::from_chars не принимает знак +, который понимал std::stod
+	const std::string_view number = !text.empty() && text[0] == '+' ? text.substr(1) : text;
+	double boost = 0;
+	const auto [end, error] = std::from_chars(number.data(), number.data() + number.size(), boost);
+	if (number.empty() || error != std::errc() || end != number.data() + number.size() || !std::isfinite(boost) || boost <= 0) {
+		throw std::invalid_argument("Invalid boost "s + std::string(text));
+	}
+	return boost;
+}
+
+const char QUERY_ESCAPE = '\\';
+
+// символ в позиции pos экранирован нечётным числом \ перед ним
+bool IsEscaped(const std::string_view text, size_t pos) {
+	size_t escape_count = 0;
+	while (escape_count < pos && text[pos - escape_count - 1] == QUERY_ESCAPE) {
+		++escape_count;
+	}
+	return escape_count % 2 == 1;
+}
+
+// первый неэкранированный символ из chars, начиная с pos; text.size(), если его нет
+size_t FindUnescaped(const std::string_view text, const std::string_view chars, size_t pos) {
+	for (; pos < text.size(); ++pos) {
+		if (text[pos] == QUERY_ESCAPE) {
+			++pos;
+		} else if (chars.find(text[pos]) != std::string_view::npos) {
+			return pos;
+		}
+	}
+	return text.size();
+}
+
+// Нечёткие расширения слов, LRU на MAX_FUZZY_CACHE_SIZE слов; один на поток и на все серверы.
+// Ключ — версия словаря сервера и слово, термины указывают в словарь сервера
+class FuzzyExpansionCache {
+public:
+	const std::vector<std::string_view>* Find(uint64_t version, const std::string_view word) {
+		const auto it = index_.find({version, word});
+		if (it == index_.end()) {
+			return nullptr;
+		}
+		entries_.splice(entries_.begin(), entries_, it->second);
+		return &it->second->terms;
+	}
+
+	void Insert(uint64_t version, const std::string_view word, std::vector<std::string_view> terms) {
+		entries_.push_front({version, std::string(word), std::move(terms)});
+		index_.emplace(std::make_pair(version, std::string_view(entries_.front().word)), entries_.begin());
+		if (entries_.size() > MAX_FUZZY_CACHE_SIZE) {
+			index_.erase({entries_.back().version, entries_.back().word});
+			entries_.pop_back();
+		}
+	}
+
+	static FuzzyExpansionCache& GetThreadCache() {
+		thread_local FuzzyExpansionCache cache;
+		return cache;
+	}
+
+private:
+	struct Entry {
+		uint64_t version;
+		std::string word;
+		std::vector<std::string_view> terms;
+	};
+	// недавно использованные в начале
+	std::list<Entry> entries_;
+	// слова ключей указывают в entries_
+	std::map<std::pair<uint64_t, std::string_view>, std::list<Entry>::iterator> index_;
+};
+
+std::atomic<uint64_t> next_dictionary_version{0};
+
+// k-путевое объединение: куча курсоров по спискам, O(n log k) без промежуточных списков
+std::pmr::vector<uint32_t> UnitePostings(const std::pmr::vector<const std::vector<uint32_t>*>& postings) {
+	std::pmr::memory_resource* const resource = postings.get_allocator().resource();
+	if (postings.size() == 1) {
+		return std::pmr::vector<uint32_t>(postings.front()->begin(), postings.front()->end(), resource);
+	}
+	using Cursor = std::pair<const uint32_t*, const uint32_t*>;
+	std::pmr::vector<Cursor> heap(resource);
+	heap.reserve(postings.size());
+	size_t total_size = 0;
+	for (const auto* ordinals : postings) {
+		if (!ordinals->empty()) {
+			heap.emplace_back(ordinals->data(), ordinals->data() + ordinals->size());
+			total_size += ordinals->size();
+		}
+	}
+	// на вершине курсор с наименьшим номером
+	const auto is_later = [](const Cursor& lhs, const Cursor& rhs) {
+		return *lhs.first > *rhs.first;
+	};
+	std::make_heap(heap.begin(), heap.end(), is_later);
+	std::pmr::vector<uint32_t> ordinals(resource);
+	ordinals.reserve(total_size);
+	while (!heap.empty()) {
+		std::pop_heap(heap.begin(), heap.end(), is_later);
+		Cursor& cursor = heap.back();
+		const uint32_t ordinal = *cursor.first;
+		if (ordinals.empty() || ordinals.back() != ordinal) {
+			ordinals.push_back(ordinal);
+		}
+		if (++cursor.first == cursor.second) {
+			heap.pop_back();
+		} else {
+			std::push_heap(heap.begin(), heap.end(), is_later);
+		}
+	}
+	return ordinals;
+}
+
+} // namespace
+
 SearchServer::SearchServer(std::string_view stop_words_text)
 : SearchServer(SplitIntoWords(stop_words_text)){
 }
@@ -10,19 +136,147 @@ SearchServer::SearchServer(const std::string& stop_words_text)
 : SearchServer(SplitIntoWords(stop_words_text)){
 }
 
+SearchServer::SearchServer(const SearchServer& other)
+: stop_words_(other.stop_words_)
+, original_stop_words_(other.original_stop_words_)
+, word_to_document_freqs_(other.word_to_document_freqs_)
+, terms_(other.terms_.size())
+, documents_(other.documents_)
+, ordinal_documents_(other.ordinal_documents_.size(), documents_.end())
+, id_freqs_word_(other.id_freqs_word_)
+, document_ids_(other.document_ids_)
+, ordinal_count_(other.ordinal_count_)
+, fuzzy_edit_distance_(other.fuzzy_edit_distance_)
+, ascii_case_folding_(other.ascii_case_folding_) {
+	// итераторы other указывают в чужой словарь и в чужие документы
+	for (auto it = word_to_document_freqs_.begin(); it != word_to_document_freqs_.end(); ++it) {
+		terms_[it->second.term_id] = it;
+	}
+	for (auto it = documents_.begin(); it != documents_.end(); ++it) {
+		ordinal_documents_[it->second.ordinal] = it;
+	}
+}
+
 void SearchServer::AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings) {
+	PROFILE_SCOPE("SearchServer::AddDocument");
 	if ((document_id < 0) || (documents_.count(document_id) > 0)) {
 		throw std::invalid_argument("Invalid document_id"s);
 	}
-	const auto words = SplitIntoWordsNoStop(document);
+	if (!ascii_case_folding_) {
+		AddDocumentWords(document_id, SplitIntoWordsNoStop(document), status, ratings);
+		return;
+	}
+	std::string folded(document.size(), '\0');
+	AddDocumentWords(document_id, SplitIntoWordsNoStop(document, folded.data()), status, ratings);
+}
 
-	const double inv_word_count = 1.0 / words.size();
-	for (const std::string& word : words) {
-		word_to_document_freqs_[word][document_id] += inv_word_count;
-		id_freqs_word_[document_id][word] +=inv_word_count;
+void SearchServer::AddDocumentWords(int document_id, const std::vector<std::string_view>& words, DocumentStatus status,
+const std::vector<int>& ratings) {
+	if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+		throw std::invalid_argument("Invalid document_id"s);
 	}
-	documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status});
+	std::vector<TermFrequency> term_freqs = ComputeTermFrequencies(words);
+	const uint32_t ordinal = ordinal_count_++;
+	for (const auto [term_id, term_freq] : term_freqs) {
+		terms_[term_id]->second.Insert(ordinal, term_freq);
+	}
+	if (!term_freqs.empty()) {
+		id_freqs_word_.emplace(document_id, std::move(term_freqs));
+	}
+	const RatingSum rating_sum = AggregateRatings(std::execution::par, ratings);
+	ordinal_documents_.push_back(documents_.emplace(document_id, DocumentData{rating_sum.GetAverage(), status, ordinal, rating_sum}).first);
 	document_ids_.insert(document_id);
+	if (fuzzy_edit_distance_ > 0) {
+		dictionary_version_.Advance();
+	}
+}
+
+void SearchServer::UpdateDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings) {
+	PROFILE_SCOPE("SearchServer::UpdateDocument");
+	if (documents_.count(document_id) == 0) {
+		throw std::invalid_argument("Invalid document_id"s);
+	}
+	if (!ascii_case_folding_) {
+		UpdateDocumentWords(document_id, SplitIntoWordsNoStop(document), status, ratings);
+		return;
+	}
+	std::string folded(document.size(), '\0');
+	UpdateDocumentWords(document_id, SplitIntoWordsNoStop(document, folded.data()), status, ratings);
+}
+
+void SearchServer::UpdateDocumentWords(int document_id, const std::vector<std::string_view>& words, DocumentStatus status,
+const std::vector<int>& ratings) {
+	const auto document = documents_.find(document_id);
+	if (document == documents_.end()) {
+		throw std::invalid_argument("Invalid document_id"s);
+	}
+	std::vector<TermFrequency> new_freqs = ComputeTermFrequencies(words);
+	const auto old_it = id_freqs_word_.find(document_id);
+	const std::vector<TermFrequency> no_freqs;
+	const std::vector<TermFrequency>& old_freqs = old_it == id_freqs_word_.end() ? no_freqs : old_it->second;
+	// оба списка отсортированы по term_id: правятся только списки документов изменившихся слов
+	bool terms_changed = false;
+	size_t i = 0;
+	size_t j = 0;
+	while (i < old_freqs.size() || j < new_freqs.size()) {
+		if (j == new_freqs.size() || (i < old_freqs.size() && old_freqs[i].term_id < new_freqs[j].term_id)) {
+			terms_[old_freqs[i++].term_id]->second.Erase({document->second.ordinal});
+			terms_changed = true;
+		} else if (i == old_freqs.size() || new_freqs[j].term_id < old_freqs[i].term_id) {
+			terms_[new_freqs[j].term_id]->second.Insert(document->second.ordinal, new_freqs[j].term_freq);
+			terms_changed = true;
+			++j;
+		} else {
+			if (old_freqs[i].term_freq != new_freqs[j].term_freq) {
+				TermPostings& postings = terms_[new_freqs[j].term_id]->second;
+				postings.term_freqs[postings.Find(document->second.ordinal)] = new_freqs[j].term_freq;
+			}
+			++i;
+			++j;
+		}
+	}
+	if (new_freqs.empty()) {
+		if (old_it != id_freqs_word_.end()) {
+			id_freqs_word_.erase(old_it);
+		}
+	} else if (old_it == id_freqs_word_.end()) {
+		id_freqs_word_.emplace(document_id, std::move(new_freqs));
+	} else {
+		old_it->second = std::move(new_freqs);
+	}
+	// номер документа сохраняется: он не виден снаружи
+	const RatingSum rating_sum = AggregateRatings(std::execution::par, ratings);
+	document->second.rating = rating_sum.GetAverage();
+	document->second.status = status;
+	document->second.rating_sum = rating_sum;
+	if (terms_changed && fuzzy_edit_distance_ > 0) {
+		dictionary_version_.Advance();
+	}
+}
+
+void SearchServer::SetStatus(int document_id, DocumentStatus status) {
+	const auto it = documents_.find(document_id);
+	if (it == documents_.end()) {
+		throw std::invalid_argument("Invalid document_id"s);
+	}
+	it->second.status = status;
+}
+
+void SearchServer::AddRatings(int document_id, const std::vector<int>& ratings) {
+	const auto it = documents_.find(document_id);
+	if (it == documents_.end()) {
+		throw std::invalid_argument("Invalid document_id"s);
+	}
+	it->second.rating_sum += AggregateRatings(std::execution::par, ratings);
+	it->second.rating = it->second.rating_sum.GetAverage();
+}
+
+RatingSum SearchServer::GetRatingSum(int document_id) const {
+	const auto it = documents_.find(document_id);
+	if (it == documents_.end()) {
+		throw std::invalid_argument("Invalid document_id"s);
+	}
+	return it->second.rating_sum;
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const {
@@ -39,6 +293,18 @@ int SearchServer::GetDocumentCount() const {
 	return documents_.size();
 }
 
+bool SearchServer::HasDocument(int document_id) const {
+	return documents_.count(document_id) > 0;
+}
+
+std::optional<uint32_t> SearchServer::FindDocumentOrdinal(int document_id) const {
+	const auto it = documents_.find(document_id);
+	if (it == documents_.end()) {
+		return std::nullopt;
+	}
+	return it->second.ordinal;
+}
+
 std::set<int>::const_iterator SearchServer::begin() const{
 	return document_ids_.cbegin();
 }
@@ -47,69 +313,392 @@ std::set<int>::const_iterator SearchServer::end() const{
 	return document_ids_.cend();
 }
 
-const std::map<std::string, double>& SearchServer::GetWordFrequencies(int document_id) const{
-    static std::map<std::string,double> result;
-	if (id_freqs_word_.count(document_id)) {
-		return id_freqs_word_.at(document_id);
+SearchServer::WordFrequencies SearchServer::GetWordFrequencies(int document_id) const{
+	const auto it = id_freqs_word_.find(document_id);
+	if (it == id_freqs_word_.end()) {
+		return {};
 	}
+	const auto& term_freqs = it->second;
+	return {term_freqs.data(), term_freqs.data() + term_freqs.size(), &terms_};
+}
+
+SearchServer::WordFrequencies::WordFrequencies(const TermFrequency* begin, const TermFrequency* end,
+const std::vector<Dictionary::iterator>* terms)
+: begin_(begin)
+, end_(end)
+, terms_(terms) {
+}
+
+SearchServer::WordFrequencies::Iterator SearchServer::WordFrequencies::begin() const {
+	return {begin_, terms_};
+}
+
+SearchServer::WordFrequencies::Iterator SearchServer::WordFrequencies::end() const {
+	return {end_, terms_};
+}
+
+size_t SearchServer::WordFrequencies::size() const {
+	return end_ - begin_;
+}
+
+bool SearchServer::WordFrequencies::empty() const {
+	return begin_ == end_;
+}
+
+const TermFrequency& SearchServer::WordFrequencies::operator[](size_t index) const {
+	return begin_[index];
+}
+
+SearchServer::WordFrequencies::Iterator::Iterator(const TermFrequency* entry, const std::vector<Dictionary::iterator>* terms)
+: entry_(entry)
+, terms_(terms) {
+}
+
+SearchServer::WordFrequencies::Iterator::value_type SearchServer::WordFrequencies::Iterator::operator*() const {
+	return {(*terms_)[entry_->term_id]->first, entry_->term_freq};
+}
+
+SearchServer::WordFrequencies::Iterator::value_type SearchServer::WordFrequencies::Iterator::operator[](difference_type offset) const {
+	return *(*this + offset);
+}
+
+SearchServer::WordFrequencies::Iterator& SearchServer::WordFrequencies::Iterator::operator++() {
+	++entry_;
+	return *this;
+}
+
+SearchServer::WordFrequencies::Iterator SearchServer::WordFrequencies::Iterator::operator++(int) {
+	const Iterator result = *this;
+	++entry_;
 	return result;
 }
 
-void SearchServer::RemoveDocument(int document_id) {
-	if (document_ids_.count(document_id)) {
-		for_each(word_to_document_freqs_.begin(), word_to_document_freqs_.end(),
-			[document_id](auto& pair) {
-				auto it = pair.second.find(document_id);
-				if (it != pair.second.end())
-					pair.second.erase(it);
-			});
-		documents_.erase(document_id);
-		document_ids_.erase(document_id);
-		id_freqs_word_.erase(document_id);
+SearchServer::WordFrequencies::Iterator& SearchServer::WordFrequencies::Iterator::operator--() {
+	--entry_;
+	return *this;
+}
+
+SearchServer::WordFrequencies::Iterator SearchServer::WordFrequencies::Iterator::operator--(int) {
+	const Iterator result = *this;
+	--entry_;
+	return result;
+}
+
+SearchServer::WordFrequencies::Iterator& SearchServer::WordFrequencies::Iterator::operator+=(difference_type offset) {
+	entry_ += offset;
+	return *this;
+}
+
+SearchServer::WordFrequencies::Iterator& SearchServer::WordFrequencies::Iterator::operator-=(difference_type offset) {
+	entry_ -= offset;
+	return *this;
+}
+
+SearchServer::WordFrequencies::Iterator SearchServer::WordFrequencies::Iterator::operator+(difference_type offset) const {
+	return {entry_ + offset, terms_};
+}
+
+SearchServer::WordFrequencies::Iterator SearchServer::WordFrequencies::Iterator::operator-(difference_type offset) const {
+	return {entry_ - offset, terms_};
+}
+
+SearchServer::WordFrequencies::Iterator::difference_type SearchServer::WordFrequencies::Iterator::operator-(const Iterator& other) const {
+	return entry_ - other.entry_;
+}
+
+bool SearchServer::WordFrequencies::Iterator::operator==(const Iterator& other) const {
+	return entry_ == other.entry_;
+}
+
+bool SearchServer::WordFrequencies::Iterator::operator!=(const Iterator& other) const {
+	return entry_ != other.entry_;
+}
+
+bool SearchServer::WordFrequencies::Iterator::operator<(const Iterator& other) const {
+	return entry_ < other.entry_;
+}
+
+bool SearchServer::WordFrequencies::Iterator::operator>(const Iterator& other) const {
+	return entry_ > other.entry_;
+}
+
+bool SearchServer::WordFrequencies::Iterator::operator<=(const Iterator& other) const {
+	return entry_ <= other.entry_;
+}
+
+bool SearchServer::WordFrequencies::Iterator::operator>=(const Iterator& other) const {
+	return entry_ >= other.entry_;
+}
+
+template <typename Terms>
+void SearchServer::CollectTermsByPrefix(const std::string_view prefix, size_t max_count, Terms& terms) const {
+	for (auto it = word_to_document_freqs_.lower_bound(prefix);
+		it != word_to_document_freqs_.end() && terms.size() < max_count; ++it) {
+		const std::string_view term = it->first;
+		if (term.substr(0, prefix.size()) != prefix) {
+			break;
+		}
+		// после RemoveDocument в словаре могут остаться пустые списки
+		if (!it->second.empty()) {
+			terms.push_back(term);
+		}
+	}
+}
+
+std::vector<std::string_view> SearchServer::FindTermsByPrefix(const std::string_view prefix, size_t max_count) const {
+	std::vector<std::string_view> terms;
+	CollectTermsByPrefix(prefix, max_count, terms);
+	return terms;
+}
+
+std::vector<LevenshteinAutomaton::Match> SearchServer::FindFuzzyMatches(const std::string_view word, int max_edit_distance) const {
+	return LevenshteinAutomaton(word, max_edit_distance).Intersect(word_to_document_freqs_,
+		[](const Dictionary::value_type& term) {
+			return !term.second.empty();
+		});
+}
+
+std::vector<std::string_view> SearchServer::FindTermsByEditDistance(const std::string_view word, int max_edit_distance, size_t max_count) const {
+	auto matches = FindFuzzyMatches(word, max_edit_distance);
+	// автомат обходит словарь по алфавиту, поэтому ранжирование — после сбора всех совпадений
+	const auto is_better = [this](const LevenshteinAutomaton::Match& lhs, const LevenshteinAutomaton::Match& rhs) {
+		if (lhs.distance != rhs.distance) {
+			return lhs.distance < rhs.distance;
+		}
+		const size_t lhs_freq = FindPostings(lhs.term)->size();
+		const size_t rhs_freq = FindPostings(rhs.term)->size();
+		return lhs_freq != rhs_freq ? lhs_freq > rhs_freq : lhs.term < rhs.term;
+	};
+	const size_t count = std::min(max_count, matches.size());
+	std::partial_sort(matches.begin(), matches.begin() + count, matches.end(), is_better);
+	std::vector<std::string_view> terms;
+	terms.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		terms.push_back(matches[i].term);
+	}
+	return terms;
+}
+
+void SearchServer::SetFuzzyMatching(int max_edit_distance) {
+	if (max_edit_distance < 0 || max_edit_distance > MAX_FUZZY_EDIT_DISTANCE) {
+		throw std::invalid_argument("Invalid edit distance"s);
+	}
+	fuzzy_edit_distance_ = max_edit_distance;
+	dictionary_version_.Advance();
+}
+
+void SearchServer::SetAsciiCaseFolding(bool enabled) {
+	if (!documents_.empty()) {
+		throw std::invalid_argument("Case folding can't be changed after documents are added"s);
+	}
+	if (enabled == ascii_case_folding_) {
+		return;
+	}
+	if (enabled) {
+		std::set<std::string, std::less<>> folded_stop_words;
+		for (const std::string_view word : stop_words_.GetWords()) {
+			std::string folded(word.size(), '\0');
+			FoldAsciiCase(word, folded.data());
+			folded_stop_words.insert(std::move(folded));
+		}
+		original_stop_words_ = std::move(stop_words_);
+		stop_words_ = StopWordSet(folded_stop_words);
+	} else {
+		stop_words_ = std::move(*original_stop_words_);
+		original_stop_words_.reset();
+	}
+	ascii_case_folding_ = enabled;
+}
+
+bool SearchServer::IsAsciiCaseFolding() const {
+	return ascii_case_folding_;
+}
+
+void SearchServer::MergeFrom(const SearchServer& other, const std::set<int>& excluded_ids) {
+	PROFILE_SCOPE("SearchServer::MergeFrom");
+	for (const auto& [document_id, document_data] : other.documents_) {
+		if (excluded_ids.count(document_id) == 0) {
+			CopyDocument(other, document_id, document_data);
+		}
+	}
+	if (fuzzy_edit_distance_ > 0) {
+		dictionary_version_.Advance();
+	}
+}
+
+void SearchServer::MergeFrom(const SearchServer& other, const OrdinalBitmap& excluded_ordinals) {
+	PROFILE_SCOPE("SearchServer::MergeFrom");
+	for (const auto& [document_id, document_data] : other.documents_) {
+		if (!excluded_ordinals.Contains(document_data.ordinal)) {
+			CopyDocument(other, document_id, document_data);
+		}
+	}
+	if (fuzzy_edit_distance_ > 0) {
+		dictionary_version_.Advance();
+	}
+}
+
+void SearchServer::ShrinkToFit() {
+	for (auto& [word, postings] : word_to_document_freqs_) {
+		postings.ordinals.shrink_to_fit();
+		postings.term_freqs.shrink_to_fit();
+	}
+	for (auto& [document_id, term_freqs] : id_freqs_word_) {
+		term_freqs.shrink_to_fit();
+	}
+	terms_.shrink_to_fit();
+	ordinal_documents_.shrink_to_fit();
+}
+
+void SearchServer::MergeDocument(const SearchServer& other, int document_id) {
+	const auto it = other.documents_.find(document_id);
+	if (it == other.documents_.end()) {
+		throw std::invalid_argument("Invalid document_id"s);
+	}
+	CopyDocument(other, document_id, it->second);
+	if (fuzzy_edit_distance_ > 0) {
+		dictionary_version_.Advance();
 	}
 }
 
-void SearchServer::RemoveDocument(std::execution::parallel_policy, int document_id) {
-	if (document_ids_.count(document_id)) {
-		for_each(std::execution::par,
-			word_to_document_freqs_.begin(), word_to_document_freqs_.end(),
-			[document_id](auto& pair) {
-				auto it = pair.second.find(document_id);
-				if (it != pair.second.end())
-					pair.second.erase(it);
-			});
-		documents_.erase(document_id);
-		document_ids_.erase(document_id);
-		id_freqs_word_.erase(document_id);
+void SearchServer::CopyDocument(const SearchServer& other, int document_id, const DocumentData& document_data) {
+	if (documents_.count(document_id)) {
+		throw std::invalid_argument("Invalid document_id"s);
+	}
+	const uint32_t ordinal = ordinal_count_++;
+	ordinal_documents_.push_back(documents_.emplace(document_id,
+		DocumentData{document_data.rating, document_data.status, ordinal, document_data.rating_sum}).first);
+	document_ids_.insert(document_id);
+	const auto it = other.id_freqs_word_.find(document_id);
+	if (it == other.id_freqs_word_.end()) {
+		return;
+	}
+	// номера слов у серверов свои
+	std::vector<TermFrequency> term_freqs;
+	term_freqs.reserve(it->second.size());
+	for (const auto [other_term_id, term_freq] : it->second) {
+		const auto term = GetOrAddTerm(other.terms_[other_term_id]->first);
+		term->second.Insert(ordinal, term_freq);
+		term_freqs.push_back({term->second.term_id, term_freq});
+	}
+	std::sort(term_freqs.begin(), term_freqs.end(), [](const TermFrequency& lhs, const TermFrequency& rhs) {
+		return lhs.term_id < rhs.term_id;
+	});
+	id_freqs_word_.emplace(document_id, std::move(term_freqs));
+}
+
+SearchServer::DictionaryVersion::DictionaryVersion()
+: value_(next_dictionary_version.fetch_add(1, std::memory_order_relaxed)) {
+}
+
+SearchServer::DictionaryVersion::DictionaryVersion(const DictionaryVersion&)
+: DictionaryVersion() {
+}
+
+SearchServer::DictionaryVersion::DictionaryVersion(DictionaryVersion&& other)
+: DictionaryVersion() {
+	// словарь переехал: записи кэша по старой версии не должны находиться и у покинутого сервера
+	other.Advance();
+}
+
+void SearchServer::DictionaryVersion::Advance() {
+	value_ = next_dictionary_version.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t SearchServer::DictionaryVersion::Get() const {
+	return value_;
+}
+
+void SearchServer::ExpandFuzzy(const std::string_view word, std::pmr::vector<std::string_view>& terms) const {
+	FuzzyExpansionCache& cache = FuzzyExpansionCache::GetThreadCache();
+	if (const auto* expansion = cache.Find(dictionary_version_.Get(), word)) {
+		terms.insert(terms.end(), expansion->begin(), expansion->end());
+		return;
 	}
+	// промах кэша: расширение сохраняется в кэше потока, а не в памяти запроса
+	auto expansion = FindTermsByEditDistance(word, fuzzy_edit_distance_);
+	terms.insert(terms.end(), expansion.begin(), expansion.end());
+	cache.Insert(dictionary_version_.Get(), word, std::move(expansion));
 }
 
-void SearchServer::RemoveDocument(std::execution::sequenced_policy, int document_id) {
-	RemoveDocument(document_id);
+void SearchServer::RemoveDocument(int document_id) {
+	RemoveDocuments(std::execution::seq, {document_id});
+}
+
+void SearchServer::RemoveDocument(std::execution::parallel_policy policy, int document_id) {
+	RemoveDocuments(policy, {document_id});
+}
+
+void SearchServer::RemoveDocument(std::execution::sequenced_policy policy, int document_id) {
+	RemoveDocuments(policy, {document_id});
+}
+
+void SearchServer::RemoveDocuments(const std::vector<int>& document_ids) {
+	EraseDocuments(std::execution::seq, document_ids);
+}
+
+void SearchServer::RemoveDocuments(std::execution::parallel_policy policy, const std::vector<int>& document_ids) {
+	EraseDocuments(policy, document_ids);
+}
+
+void SearchServer::RemoveDocuments(std::execution::sequenced_policy policy, const std::vector<int>& document_ids) {
+	EraseDocuments(policy, document_ids);
+}
+
+template <typename ExecutionPolicy>
+void SearchServer::EraseDocuments(const ExecutionPolicy& policy, const std::vector<int>& document_ids) {
+	PROFILE_SCOPE("SearchServer::EraseDocuments");
+	// удаляемые документы группируются по словам через прямой индекс
+	std::map<TermPostings*, std::vector<uint32_t>> postings_to_ordinals;
+	for (const int document_id : document_ids) {
+		const auto it = id_freqs_word_.find(document_id);
+		if (it == id_freqs_word_.end()) {
+			continue;
+		}
+		const uint32_t ordinal = documents_.at(document_id).ordinal;
+		for (const auto [term_id, _] : it->second) {
+			postings_to_ordinals[&terms_[term_id]->second].push_back(ordinal);
+		}
+	}
+	std::vector<std::pair<TermPostings*, std::vector<uint32_t>>> groups(postings_to_ordinals.begin(), postings_to_ordinals.end());
+	std::for_each(policy, groups.begin(), groups.end(),
+		[](auto& group) {
+			group.first->Erase(std::move(group.second));
+		});
+
+	bool removed = false;
+	for (const int document_id : document_ids) {
+		if (documents_.erase(document_id)) {
+			document_ids_.erase(document_id);
+			id_freqs_word_.erase(document_id);
+			removed = true;
+		}
+	}
+	if (removed && fuzzy_edit_distance_ > 0) {
+		dictionary_version_.Advance();
+	}
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::string_view raw_query, int document_id) const {
-	const auto query = ParseQuery(raw_query);
-        std::vector<std::string_view> matched_words;
-        for (auto& word : query.plus_words) {
-            if (word_to_document_freqs_.count(std::string(word)) == 0) {
-                continue;
-            }
-            if (word_to_document_freqs_.at(std::string(word)).count(document_id)) {
-                matched_words.push_back(std::string_view(word));
-            }
-        }
-        for (std::string_view word : query.minus_words) {
-            if (word_to_document_freqs_.count(std::string(word)) == 0) {
-                continue;
-            }
-            if (word_to_document_freqs_.at(std::string(word)).count(document_id)) {
-                matched_words.clear();
-                break;
-            }
-        }
-        return {matched_words, documents_.at(document_id).status};
-    }
+	const QueryArena::Scope arena_scope(QueryArena::GetThreadArena());
+	const auto query = ParseQuery(raw_query, arena_scope.GetResource());
+	const DocumentData& document_data = documents_.at(document_id);
+	const auto contains_document = [this, ordinal = document_data.ordinal](const std::string_view word) {
+		return HasWord(word, ordinal);
+	};
+	std::vector<std::string_view> matched_words;
+	if (std::any_of(query.minus_words.begin(), query.minus_words.end(), contains_document) || !HasRequiredWords(query, document_data.ordinal)) {
+		return {matched_words, document_data.status};
+	}
+	matched_words.reserve(query.plus_words.size());
+	for (const std::string_view word : query.plus_words) {
+		if (contains_document(word)) {
+			// ссылка на слово словаря, а не на временный запрос
+			matched_words.push_back(word_to_document_freqs_.find(word)->first);
+		}
+	}
+	return {matched_words, document_data.status};
+}
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::sequenced_policy,
 const std::string_view raw_query, int document_id) const {
@@ -118,94 +707,500 @@ const std::string_view raw_query, int document_id) const {
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::parallel_policy,
 	const std::string_view raw_query, int document_id) const {
-	const auto query = ParseQuery(raw_query);	
-	static std::vector<std::string_view> matched_words;
-        std::remove_copy_if(std::execution::par, query.plus_words.begin(), query.plus_words.end(),
-                      std::back_inserter(matched_words),
-                       [=](auto word){
-            return word_to_document_freqs_.count(word) && word_to_document_freqs_.at(word).count(document_id);
-        });
-	for (const std::string& word : query.minus_words) {
-		if (word_to_document_freqs_.count(word) == 0) {
-			continue;
-		}
-		if (word_to_document_freqs_.at(word).count(document_id)) {
-			matched_words.clear();
-			break;
+	const QueryArena::Scope arena_scope(QueryArena::GetThreadArena());
+	const auto query = ParseQuery(raw_query, arena_scope.GetResource());
+	const DocumentData& document_data = documents_.at(document_id);
+	const uint32_t ordinal = document_data.ordinal;
+	std::vector<std::string_view> matched_words;
+	const bool has_minus_word = std::any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(),
+		[this, ordinal](const std::string_view word) {
+			return HasWord(word, ordinal);
+		});
+	if (has_minus_word || !HasRequiredWords(query, ordinal)) {
+		return {matched_words, document_data.status};
+	}
+	matched_words.resize(query.plus_words.size());
+	std::transform(std::execution::par, query.plus_words.begin(), query.plus_words.end(), matched_words.begin(),
+		[this, ordinal](const std::string_view word) {
+			const auto it = word_to_document_freqs_.find(word);
+			if (it == word_to_document_freqs_.end() || it->second.Find(ordinal) == it->second.size()) {
+				return std::string_view();
+			}
+			return std::string_view(it->first);
+		});
+	matched_words.erase(std::remove(matched_words.begin(), matched_words.end(), std::string_view()), matched_words.end());
+	return {matched_words, document_data.status};
+}
+
+SearchServer::Dictionary::iterator SearchServer::GetOrAddTerm(const std::string_view word) {
+	auto it = word_to_document_freqs_.find(word);
+	if (it == word_to_document_freqs_.end()) {
+		it = word_to_document_freqs_.emplace(std::string(word), TermPostings{static_cast<int>(terms_.size()), {}, {}}).first;
+		terms_.push_back(it);
+	}
+	return it;
+}
+
+std::vector<TermFrequency> SearchServer::ComputeTermFrequencies(const std::vector<std::string_view>& words) {
+	const double inv_word_count = 1.0 / words.size();
+	std::vector<TermFrequency> term_freqs;
+	term_freqs.reserve(words.size());
+	for (const std::string_view word : words) {
+		term_freqs.push_back({GetOrAddTerm(word)->second.term_id, inv_word_count});
+	}
+	std::sort(term_freqs.begin(), term_freqs.end(), [](const TermFrequency& lhs, const TermFrequency& rhs) {
+		return lhs.term_id < rhs.term_id;
+	});
+	// повторы слова складываются в одну запись
+	size_t unique_count = 0;
+	for (const TermFrequency& entry : term_freqs) {
+		if (unique_count > 0 && term_freqs[unique_count - 1].term_id == entry.term_id) {
+			term_freqs[unique_count - 1].term_freq += entry.term_freq;
+		} else {
+			term_freqs[unique_count++] = entry;
 		}
 	}
-	return {matched_words, documents_.at(document_id).status};
+	term_freqs.resize(unique_count);
+	term_freqs.shrink_to_fit();
+	return term_freqs;
 }
 
+const SearchServer::TermPostings* SearchServer::FindPostings(const std::string_view word) const {
+	const auto it = word_to_document_freqs_.find(word);
+	if (it == word_to_document_freqs_.end()) {
+		return nullptr;
+	}
+	return &it->second;
+}
 
-bool SearchServer::IsStopWord(const std::string& word) const {
-	return stop_words_.count(word) > 0;
+bool SearchServer::HasWord(const std::string_view word, uint32_t ordinal) const {
+	const auto* postings = FindPostings(word);
+	return postings && postings->Find(ordinal) != postings->size();
 }
 
-bool SearchServer::IsValidWord(const std::string& word) {
-	return none_of(word.begin(), word.end(), [](char c) {
-		return c >= '\0' && c < ' ';
-	});
+size_t SearchServer::TermPostings::size() const {
+	return ordinals.size();
 }
 
-std::vector<std::string> SearchServer::SplitIntoWordsNoStop(const std::string_view text) const {
-	std::vector<std::string> words;
-    for (const std::string& word : SplitIntoWords(text)) {
-		if (!IsValidWord(word)) {
-			throw std::invalid_argument("Word "s + word + " is invalid"s);
-		}
-		if (!IsStopWord(word)) {
-			words.push_back(word);
+bool SearchServer::TermPostings::empty() const {
+	return ordinals.empty();
+}
+
+size_t SearchServer::TermPostings::Find(uint32_t ordinal) const {
+	const auto it = std::lower_bound(ordinals.begin(), ordinals.end(), ordinal);
+	return it != ordinals.end() && *it == ordinal ? it - ordinals.begin() : size();
+}
+
+void SearchServer::TermPostings::Insert(uint32_t ordinal, double term_freq) {
+	// новый документ дописывается в конец, в середину попадают только слова, добавленные UpdateDocument
+	const size_t position = std::lower_bound(ordinals.begin(), ordinals.end(), ordinal) - ordinals.begin();
+	ordinals.insert(ordinals.begin() + position, ordinal);
+	term_freqs.insert(term_freqs.begin() + position, term_freq);
+}
+
+void SearchServer::TermPostings::Erase(std::vector<uint32_t> removed_ordinals) {
+	std::sort(removed_ordinals.begin(), removed_ordinals.end());
+	auto removed_it = removed_ordinals.begin();
+	size_t kept = 0;
+	for (size_t i = 0; i < size(); ++i) {
+		removed_it = std::lower_bound(removed_it, removed_ordinals.end(), ordinals[i]);
+		if (removed_it != removed_ordinals.end() && *removed_it == ordinals[i]) {
+			continue;
 		}
+		ordinals[kept] = ordinals[i];
+		term_freqs[kept] = term_freqs[i];
+		++kept;
 	}
-	return words;
+	ordinals.resize(kept);
+	term_freqs.resize(kept);
+}
+
+bool SearchServer::IsStopWord(const std::string_view word) const {
+	return stop_words_.Contains(word);
+}
+
+bool SearchServer::IsValidWord(const std::string_view word) {
+	return std::none_of(word.begin(), word.end(), [](char c) {
+		return c >= '\0' && c < ' ';
+	});
 }
 
-int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
-	if (ratings.empty()) {
-		return 0;
+StopWordSet SearchServer::MakeStopWords(const std::set<std::string, std::less<>>& stop_words) {
+	if (!std::all_of(stop_words.begin(), stop_words.end(), IsValidWord)) {
+		throw std::invalid_argument("Some of stop words are invalid"s);
 	}
-	int rating_sum = 0;
-	for (const int rating : ratings) {
-		rating_sum += rating;
+	return StopWordSet(stop_words);
+}
+
+std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(const std::string_view text, char* folded) const {
+	if (ascii_case_folding_ && !folded) {
+		throw std::invalid_argument("Case folding needs a buffer for the text"s);
 	}
-	return rating_sum / static_cast<int>(ratings.size());
+	std::vector<std::string_view> words;
+	TokenizeWords(text, ascii_case_folding_ ? folded : nullptr, words);
+	words.erase(std::remove_if(words.begin(), words.end(), [this](const std::string_view word) {
+		return IsStopWord(word);
+	}), words.end());
+	return words;
+}
+
+SearchServer::Query::Query(std::pmr::memory_resource* resource)
+: plus_words(resource)
+, minus_words(resource)
+, prefix_words(resource)
+, fuzzy_words(resource)
+, boosts(resource)
+, required_groups(resource) {
 }
 
-SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string& text) const {
+std::pmr::memory_resource* SearchServer::Query::GetResource() const {
+	return plus_words.get_allocator().resource();
+}
+
+SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string_view text, std::pmr::memory_resource* resource) const {
 	if (text.empty()) {
 		throw std::invalid_argument("Query word is empty"s);
 	}
-	std::string word = text;
-	bool is_minus = false;
-	if (word[0] == '-') {
-		is_minus = true;
-		word = word.substr(1);
+	std::string_view word = text;
+	double boost = 1.0;
+	const size_t boost_pos = FindUnescaped(word, "^", 0);
+	if (boost_pos != word.size()) {
+		boost = ParseBoost(word.substr(boost_pos + 1));
+		word.remove_suffix(word.size() - boost_pos);
+	}
+	bool is_prefix = false;
+	if (!word.empty() && word.back() == '*' && !IsEscaped(word, word.size() - 1)) {
+		is_prefix = true;
+		word.remove_suffix(1);
 	}
-	if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
-		throw std::invalid_argument("Query word "s + text + " is invalid");
+	// \ в конце ничего не экранирует
+	if (word.empty() || word[0] == '-' || word[0] == '+' || FindUnescaped(word, "()|^", 0) != word.size()
+		|| (word.back() == QUERY_ESCAPE && !IsEscaped(word, word.size() - 1))) {
+		throw std::invalid_argument("Query word "s + std::string(text) + " is invalid");
+	}
+	if (word.find(QUERY_ESCAPE) != std::string_view::npos) {
+		char* const unescaped = static_cast<char*>(resource->allocate(word.size(), alignof(char)));
+		size_t size = 0;
+		for (size_t i = 0; i < word.size(); ++i) {
+			if (word[i] == QUERY_ESCAPE) {
+				++i;
+			}
+			unescaped[size++] = word[i];
+		}
+		word = std::string_view(unescaped, size);
+	}
+	if (!IsValidWord(word)) {
+		throw std::invalid_argument("Query word "s + std::string(text) + " is invalid");
 	}
 
-	return {word, is_minus, IsStopWord(word)};
+	return {word, !is_prefix && IsStopWord(word), is_prefix, boost};
 }
 
-SearchServer::Query SearchServer::ParseQuery(const std::string_view text) const {
-	Query result;
-    for (auto& word : SplitIntoWords(text)) {
-		const auto query_word = ParseQueryWord(word);
-		if (!query_word.is_stop) {
-			if (query_word.is_minus) {
-				result.minus_words.insert(query_word.data);
-			} else {
-				result.plus_words.insert(query_word.data);
+SearchServer::Query SearchServer::ParseQuery(const std::string_view text, std::pmr::memory_resource* resource,
+const QueryStatistics* statistics) const {
+	if (ascii_case_folding_) {
+		// слова запроса будут указывать в копию текста в памяти запроса
+		char* const folded = static_cast<char*>(resource->allocate(text.size(), alignof(char)));
+		FoldAsciiCase(text, folded);
+		return ParseFoldedQuery(std::string_view(folded, text.size()), resource, statistics);
+	}
+	return ParseFoldedQuery(text, resource, statistics);
+}
+
+SearchServer::Query SearchServer::ParseFoldedQuery(const std::string_view text, std::pmr::memory_resource* resource,
+const QueryStatistics* statistics) const {
+	Query result(resource);
+	// слова текущего слова или группы, память переиспользуется между ними
+	std::pmr::vector<QueryWord> words(resource);
+	size_t pos = 0;
+	while (pos < text.size()) {
+		if (text[pos] == ' ') {
+			++pos;
+			continue;
+		}
+		// знак относится ко всему слову или группе
+		const bool is_minus = text[pos] == '-';
+		const bool is_required = text[pos] == '+';
+		if (is_minus || is_required) {
+			++pos;
+		}
+		if (pos == text.size() || text[pos] != '(') {
+			const size_t word_end = FindUnescaped(text, " ", pos);
+			if (word_end == pos) {
+				throw std::invalid_argument("Query word "s + text[pos - 1] + " is invalid"s);
+			}
+			words.assign(1, ParseQueryWord(text.substr(pos, word_end - pos), resource));
+			AddQueryClause(words, is_minus, is_required, statistics, result);
+			pos = word_end;
+			continue;
+		}
+
+		const size_t group_end = FindUnescaped(text, ")", pos);
+		if (group_end == text.size()) {
+			throw std::invalid_argument("Query group is not closed"s);
+		}
+		// слова группы разделяются пробелами и |
+		words.clear();
+		size_t word_begin = pos + 1;
+		while (word_begin < group_end) {
+			const size_t word_end = std::min(FindUnescaped(text, " |", word_begin), group_end);
+			if (word_end > word_begin) {
+				words.push_back(ParseQueryWord(text.substr(word_begin, word_end - word_begin), resource));
+			}
+			word_begin = word_end + 1;
+		}
+		if (words.empty()) {
+			throw std::invalid_argument("Query group is empty"s);
+		}
+		pos = group_end + 1;
+		const size_t suffix_end = FindUnescaped(text, " ", pos);
+		if (suffix_end > pos) {
+			if (text[pos] != '^') {
+				throw std::invalid_argument("Query group "s + std::string(text.substr(0, suffix_end)) + " is invalid"s);
+			}
+			const double boost = ParseBoost(text.substr(pos + 1, suffix_end - pos - 1));
+			for (QueryWord& word : words) {
+				word.boost *= boost;
 			}
 		}
+		pos = suffix_end;
+		AddQueryClause(words, is_minus, is_required, statistics, result);
 	}
 	return result;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string& word) const {
-	return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+void SearchServer::AddQueryClause(const std::pmr::vector<QueryWord>& words, bool is_minus, bool is_required,
+const QueryStatistics* statistics, Query& query) const {
+	std::pmr::vector<std::string_view> group(query.GetResource());
+	std::pmr::vector<std::string_view> terms(query.GetResource());
+	bool has_words = false;
+	for (const QueryWord& query_word : words) {
+		if (query_word.is_stop) {
+			continue;
+		}
+		has_words = true;
+		terms.clear();
+		const bool is_fuzzy = !query_word.is_prefix && !is_minus && fuzzy_edit_distance_ > 0;
+		// раскрытие, выбранное по всему корпусу
+		const TermExpansion* selected = nullptr;
+		if (statistics && (query_word.is_prefix || is_fuzzy)) {
+			const auto& expansions = query_word.is_prefix ? statistics->prefix_expansions : statistics->fuzzy_expansions;
+			const auto it = expansions.find(query_word.data);
+			if (it != expansions.end()) {
+				selected = &it->second;
+			}
+		}
+		if (selected) {
+			terms.assign(selected->terms.begin(), selected->terms.end());
+		} else if (query_word.is_prefix) {
+			query.prefix_words.push_back(query_word.data);
+			CollectTermsByPrefix(query_word.data, MAX_PREFIX_EXPANSION_COUNT, terms);
+		} else if (is_fuzzy) {
+			query.fuzzy_words.push_back(query_word.data);
+			ExpandFuzzy(query_word.data, terms);
+		} else {
+			terms.push_back(query_word.data);
+		}
+
+		for (const std::string_view term : terms) {
+			if (is_minus) {
+				query.minus_words.insert(term);
+				continue;
+			}
+			// повторное слово получает больший из множителей
+			const auto it = query.boosts.find(term);
+			const double previous_boost = it != query.boosts.end() ? it->second : (query.plus_words.count(term) ? 1.0 : 0.0);
+			const double boost = std::max(previous_boost, query_word.boost);
+			if (boost != 1.0) {
+				query.boosts[term] = boost;
+			} else if (it != query.boosts.end()) {
+				query.boosts.erase(it);
+			}
+			if (is_required) {
+				group.push_back(term);
+			}
+			query.plus_words.insert(term);
+		}
+	}
+	// группа только из стоп-слов ничего не требует; группа без терминов словаря не пропускает ничего
+	if (is_required && has_words) {
+		query.required_groups.push_back(std::move(group));
+	}
+}
+
+std::pmr::vector<uint32_t> SearchServer::FindRequiredDocuments(const Query& query) const {
+	struct RequiredGroup {
+		std::pmr::vector<const std::vector<uint32_t>*> postings;
+		size_t size = 0;
+	};
+	std::pmr::memory_resource* const resource = query.GetResource();
+	std::pmr::vector<RequiredGroup> groups(resource);
+	groups.reserve(query.required_groups.size());
+	for (const auto& words : query.required_groups) {
+		RequiredGroup group{std::pmr::vector<const std::vector<uint32_t>*>(resource)};
+		for (const std::string_view word : words) {
+			const auto* postings = FindPostings(word);
+			if (postings && !postings->empty()) {
+				group.postings.push_back(&postings->ordinals);
+				group.size += postings->size();
+			}
+		}
+		if (group.postings.empty()) {
+			return std::pmr::vector<uint32_t>(resource);
+		}
+		groups.push_back(std::move(group));
+	}
+	// самая короткая группа задаёт кандидатов, остальные только отсеивают
+	std::sort(groups.begin(), groups.end(), [](const RequiredGroup& lhs, const RequiredGroup& rhs) {
+		return lhs.size < rhs.size;
+	});
+	std::pmr::vector<uint32_t> candidates = UnitePostings(groups.front().postings);
+	for (size_t i = 1; i < groups.size() && !candidates.empty(); ++i) {
+		const RequiredGroup& group = groups[i];
+		if (candidates.size() * REQUIRED_PROBE_RATIO < group.size) {
+			candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&group](uint32_t ordinal) {
+				return std::none_of(group.postings.begin(), group.postings.end(), [ordinal](const auto* ordinals) {
+					return std::binary_search(ordinals->begin(), ordinals->end(), ordinal);
+				});
+			}), candidates.end());
+		} else {
+			candidates = IntersectSorted(candidates, UnitePostings(group.postings));
+		}
+	}
+	return candidates;
+}
+
+OrdinalSet SearchServer::FindExcludedDocuments(const Query& query) const {
+	std::pmr::vector<const std::vector<uint32_t>*> minus_ordinals(query.GetResource());
+	size_t expected_count = 0;
+	for (const std::string_view word : query.minus_words) {
+		const auto it = word_to_document_freqs_.find(word);
+		if (it != word_to_document_freqs_.end() && !it->second.ordinals.empty()) {
+			minus_ordinals.push_back(&it->second.ordinals);
+			expected_count += it->second.ordinals.size();
+		}
+	}
+	OrdinalSet excluded(ordinal_count_, expected_count, query.GetResource());
+	for (const auto* ordinals : minus_ordinals) {
+		for (const uint32_t ordinal : *ordinals) {
+			excluded.Insert(ordinal);
+		}
+	}
+	excluded.Seal();
+	return excluded;
+}
+
+bool SearchServer::HasRequiredWords(const Query& query, uint32_t ordinal) const {
+	return std::all_of(query.required_groups.begin(), query.required_groups.end(), [this, ordinal](const auto& words) {
+		return std::any_of(words.begin(), words.end(), [this, ordinal](const std::string_view word) {
+			return HasWord(word, ordinal);
+		});
+	});
+}
+
+double SearchServer::ComputeWordInverseDocumentFreq(const std::string_view word, const QueryStatistics* statistics) const {
+	if (statistics) {
+		const auto it = statistics->document_freqs.find(word);
+		if (it != statistics->document_freqs.end()) {
+			return log(statistics->document_count * 1.0 / it->second);
+		}
+	}
+	return log(GetDocumentCount() * 1.0 / FindPostings(word)->size());
+}
+
+QueryStatistics SearchServer::CollectQueryStatistics(const std::string_view raw_query, size_t max_prefix_expansion_count) const {
+	QueryStatistics statistics;
+	statistics.document_count = GetDocumentCount();
+	const QueryArena::Scope arena_scope(QueryArena::GetThreadArena());
+	const Query query = ParseQuery(raw_query, arena_scope.GetResource());
+	const auto add_document_freq = [this, &statistics](const std::string_view word) {
+		const auto* postings = FindPostings(word);
+		if (postings && !postings->empty()) {
+			statistics.document_freqs.emplace(std::string(word), postings->size());
+		}
+	};
+	for (const std::string_view word : query.plus_words) {
+		add_document_freq(word);
+	}
+	// первые по алфавиту термины частей содержат первые по алфавиту термины всего корпуса
+	for (const std::string_view word : query.prefix_words) {
+		TermExpansion& expansion = statistics.prefix_expansions[std::string(word)];
+		for (const std::string_view term : FindTermsByPrefix(word, max_prefix_expansion_count)) {
+			expansion.candidates.emplace(std::string(term), 0);
+			add_document_freq(term);
+		}
+	}
+	// лучшие нечёткие термины корпуса зависят от частот во всех частях, поэтому кандидаты не ограничиваются
+	for (const std::string_view word : query.fuzzy_words) {
+		TermExpansion& expansion = statistics.fuzzy_expansions[std::string(word)];
+		for (const auto& [term, distance] : FindFuzzyMatches(word, fuzzy_edit_distance_)) {
+			expansion.candidates.emplace(std::string(term), distance);
+			add_document_freq(term);
+		}
+	}
+	statistics.SelectExpansions();
+	return statistics;
+}
+
+void QueryStatistics::Add(const QueryStatistics& other) {
+	document_count += other.document_count;
+	for (const auto& [word, document_freq] : other.document_freqs) {
+		document_freqs[word] += document_freq;
+	}
+	for (const auto& [word, expansion] : other.prefix_expansions) {
+		prefix_expansions[word].candidates.insert(expansion.candidates.begin(), expansion.candidates.end());
+	}
+	for (const auto& [word, expansion] : other.fuzzy_expansions) {
+		fuzzy_expansions[word].candidates.insert(expansion.candidates.begin(), expansion.candidates.end());
+	}
+}
+
+void QueryStatistics::SelectExpansions() {
+	// кандидат, оставшийся только в удалённых документах, не раскрывается
+	const auto get_document_freq = [this](const std::string& term) {
+		const auto it = document_freqs.find(term);
+		return it == document_freqs.end() ? 0 : it->second;
+	};
+	for (auto& [_, expansion] : prefix_expansions) {
+		expansion.terms.clear();
+		for (const auto& [term, __] : expansion.candidates) {
+			if (expansion.terms.size() == MAX_PREFIX_EXPANSION_COUNT) {
+				break;
+			}
+			if (get_document_freq(term) > 0) {
+				expansion.terms.push_back(term);
+			}
+		}
+	}
+	for (auto& [_, expansion] : fuzzy_expansions) {
+		// порядок SearchServer::FindTermsByEditDistance: расстояние, затем частота по убыванию, затем термин
+		std::vector<std::tuple<int, int, const std::string*>> ranked;
+		for (const auto& [term, distance] : expansion.candidates) {
+			const int document_freq = get_document_freq(term);
+			if (document_freq > 0) {
+				ranked.emplace_back(distance, -document_freq, &term);
+			}
+		}
+		const size_t count = std::min(MAX_FUZZY_EXPANSION_COUNT, ranked.size());
+		std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(), [](const auto& lhs, const auto& rhs) {
+			return std::tie(std::get<0>(lhs), std::get<1>(lhs), *std::get<2>(lhs)) < std::tie(std::get<0>(rhs), std::get<1>(rhs), *std::get<2>(rhs));
+		});
+		expansion.terms.clear();
+		for (size_t i = 0; i < count; ++i) {
+			expansion.terms.push_back(*std::get<2>(ranked[i]));
+		}
+	}
+}
+
+std::vector<Document> MergeTopDocuments(const std::vector<std::vector<Document>>& top_documents) {
+	std::vector<Document> result;
+	for (const auto& documents : top_documents) {
+		result.insert(result.end(), documents.begin(), documents.end());
+	}
+	const size_t count = std::min(result.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+	std::partial_sort(result.begin(), result.begin() + count, result.end(), IsMoreRelevant);
+	result.resize(count);
+	return result;
 }
 
 void AddDocument(SearchServer& search_server, int document_id, const std::string& document, DocumentStatus status,
@@ -8,24 +8,181 @@
 #include <algorithm>
 #include <string_view>
 #include <execution>
+#include <memory_resource>
+#include <optional>
+#include <atomic>
 #include "document.h"
 #include "string_processing.h"
 #include "conncurrent_map.h"
+#include "levenshtein_automaton.h"
+#include "ordinal_set.h"
+#include "posting_kernels.h"
+#include "query_arena.h"
+#include "rating_aggregator.h"
+#include "search_metrics.h"
+#include "stop_word_set.h"
 #include <cmath>
 
 using namespace std::string_literals;
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
+const size_t MAX_PREFIX_EXPANSION_COUNT = 64;
+const size_t CONCURRENT_BUCKET_COUNT = 100;
+const int MAX_FUZZY_EDIT_DISTANCE = 2;
+const size_t MAX_FUZZY_EXPANSION_COUNT = 16;
+// столько слов запросов хранит кэш нечётких расширений потока, давно не встречавшиеся вытесняются
+const size_t MAX_FUZZY_CACHE_SIZE = 4096;
+const double RELEVANCE_EPSILON = 1e-6;
+
+// раскрытие слова с * или нечёткого слова по всем частям корпуса
+struct TermExpansion {
+	// кандидаты частей с редакционным расстоянием, у префиксов 0
+	std::map<std::string, int, std::less<>> candidates;
+	// выбранные термины, их заполняет QueryStatistics::SelectExpansions
+	std::vector<std::string> terms;
+};
+
+// статистика корпуса для IDF, когда документы разнесены по нескольким серверам.
+// Раскрытия выбираются по всему корпусу, а не ограничиваются на каждой части отдельно
+struct QueryStatistics {
+	int document_count = 0;
+	// для раскрываемых слов — каждый кандидат
+	std::map<std::string, int, std::less<>> document_freqs;
+	std::map<std::string, TermExpansion, std::less<>> prefix_expansions;
+	std::map<std::string, TermExpansion, std::less<>> fuzzy_expansions;
+
+	void Add(const QueryStatistics& other);
+	// выбирает раскрытия по сложенной статистике так же, как единый SearchServer
+	void SelectExpansions();
+};
+
+inline bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+	if (std::abs(lhs.relevance - rhs.relevance) < RELEVANCE_EPSILON) {
+		return lhs.rating > rhs.rating;
+	} else {
+		return lhs.relevance > rhs.relevance;
+	}
+}
+
+// слияние топов нескольких серверов в общий топ
+std::vector<Document> MergeTopDocuments(const std::vector<std::vector<Document>>& top_documents);
+
+// элемент прямого индекса: слово документа по его номеру в словаре сервера
+struct TermFrequency {
+	int term_id;
+	double term_freq;
+};
 
 class SearchServer {
+	// Список документов слова: параллельные массивы, упорядоченные по DocumentData::ordinal.
+	// Номер нового документа больше всех прежних, поэтому добавление дописывает в конец.
+	// По ordinals работают ядра пересечения и объединения, частота берётся по той же позиции
+	struct TermPostings {
+		int term_id;
+		std::vector<uint32_t> ordinals;
+		std::vector<double> term_freqs;
+
+		size_t size() const;
+		bool empty() const;
+		// позиция документа или size()
+		size_t Find(uint32_t ordinal) const;
+		void Insert(uint32_t ordinal, double term_freq);
+		// все документы за один проход по массивам
+		void Erase(std::vector<uint32_t> removed_ordinals);
+	};
+	using Dictionary = std::map<std::string, TermPostings, std::less<>>;
+
 public:
+	// Частоты слов документа без копирования: отсортированный по term_id массив прямого индекса.
+	// Слова разрешаются через словарь только при обходе; пары (слово, частота) — как у std::map.
+	// Действительно, пока документ не удалён из сервера и не изменён UpdateDocument
+	class WordFrequencies {
+	public:
+		// Прокси-итератор: пара собирается при разыменовании и возвращается по значению, поэтому
+		// требования LegacyForwardIterator (reference — ссылка на value_type) не выполнены и категория — input.
+		// Операции произвольного доступа (it + n, it - it, it[n], сравнения) — сверх категории, за O(1);
+		// алгоритмы std по тегу их не увидят, LazyPaginator определяет их по наличию операций
+		class Iterator {
+		public:
+			using iterator_category = std::input_iterator_tag;
+			using value_type = std::pair<std::string_view, double>;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = value_type;
+
+			Iterator(const TermFrequency* entry, const std::vector<Dictionary::iterator>* terms);
+			value_type operator*() const;
+			value_type operator[](difference_type offset) const;
+			Iterator& operator++();
+			Iterator operator++(int);
+			Iterator& operator--();
+			Iterator operator--(int);
+			Iterator& operator+=(difference_type offset);
+			Iterator& operator-=(difference_type offset);
+			Iterator operator+(difference_type offset) const;
+			Iterator operator-(difference_type offset) const;
+			difference_type operator-(const Iterator& other) const;
+			bool operator==(const Iterator& other) const;
+			bool operator!=(const Iterator& other) const;
+			bool operator<(const Iterator& other) const;
+			bool operator>(const Iterator& other) const;
+			bool operator<=(const Iterator& other) const;
+			bool operator>=(const Iterator& other) const;
+			friend Iterator operator+(difference_type offset, const Iterator& iterator) {
+				return iterator + offset;
+			}
+
+		private:
+			const TermFrequency* entry_;
+			const std::vector<Dictionary::iterator>* terms_;
+		};
+
+		WordFrequencies() = default;
+		WordFrequencies(const TermFrequency* begin, const TermFrequency* end, const std::vector<Dictionary::iterator>* terms);
+
+		Iterator begin() const;
+		Iterator end() const;
+		size_t size() const;
+		bool empty() const;
+		// элемент прямого индекса без обращения к словарю
+		const TermFrequency& operator[](size_t index) const;
+
+	private:
+		const TermFrequency* begin_ = nullptr;
+		const TermFrequency* end_ = nullptr;
+		const std::vector<Dictionary::iterator>* terms_ = nullptr;
+	};
+
 	template <typename StringContainer>
 	explicit SearchServer(const StringContainer& stop_words);
+	// таблица стоп-слов, построенная при компиляции
+	template <size_t N>
+	explicit SearchServer(const StaticStopWordSet<N>& stop_words);
     explicit SearchServer(const std::string& stop_words_text);
     explicit SearchServer(const std::string_view stop_words_text);
+    SearchServer(const SearchServer& other);
+    SearchServer(SearchServer&& other) = default;
 
     void AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings);
+    // Замена текста, статуса и оценок документа. Старый и новый наборы слов сравниваются
+    // по прямому индексу, правятся только списки документов добавленных, исчезнувших
+    // и изменивших частоту слов; число документов для IDF не меняется
+    void UpdateDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings);
+    // смена статуса без переиндексации
+    void SetStatus(int document_id, DocumentStatus status);
+    // новые оценки добавляются к уже полученным, рейтинг — среднее по всем
+    void AddRatings(int document_id, const std::vector<int>& ratings);
+    RatingSum GetRatingSum(int document_id) const;
+    // Слова документа без стоп-слов, указывают в text; можно вызывать из нескольких потоков.
+    // При SetAsciiCaseFolding(true) нужен folded: туда пишется text.size() байт текста
+    // в нижнем регистре (можно сам text, если он изменяем), и слова указывают в folded
+    std::vector<std::string_view> SplitIntoWordsNoStop(const std::string_view text, char* folded = nullptr) const;
 
+	// Язык запроса: слова через пробел; -слово исключает документы, +слово обязательно,
+	// слово* — префикс, (a | b) — группа, к которой относятся знак и ^множитель, слово^2.0 — множитель.
+	// Символы + и - в начале слова, * в конце, а также ( ) | ^ и пробел — синтаксис; чтобы искать их
+	// как часть слова, перед ними ставится \, а сама \ записывается как \\. Прежде эти символы
+	// внутри слова искались буквально: запросы со словами вроде «a|b» теперь бросают invalid_argument
 	template <typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const;
     std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const;
@@ -37,54 +194,180 @@ public:
     std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentStatus status) const;
     template <typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query) const;
+    // IDF и раскрытия слов берутся из statistics, а не из документов этого сервера
+    template <typename DocumentPredicate, typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentPredicate document_predicate,
+        const QueryStatistics& statistics) const;
+    // документы с порядковыми номерами из removed пропускаются так же, как исключённые минус-словами
+    template <typename DocumentPredicate, typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentPredicate document_predicate,
+        const QueryStatistics& statistics, const OrdinalBitmap& removed) const;
+    // временные структуры запроса размещаются в arena; остальные перегрузки берут арену текущего потока
+    template <typename DocumentPredicate, typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentPredicate document_predicate,
+        QueryArena& arena) const;
+    // Кандидатов префикса не больше max_prefix_expansion_count. Часть корпуса с удалёнными документами
+    // собирает их без ограничения: термины только удалённых документов не должны занимать места живых
+    QueryStatistics CollectQueryStatistics(const std::string_view raw_query, size_t max_prefix_expansion_count = MAX_PREFIX_EXPANSION_COUNT) const;
 
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view raw_query, int document_id) const;
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::execution::parallel_policy, const std::string_view raw_query, int document_id) const;
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::execution::sequenced_policy, const std::string_view raw_query, int document_id) const;
 
 	int GetDocumentCount() const;
+	bool HasDocument(int document_id) const;
+	std::optional<uint32_t> FindDocumentOrdinal(int document_id) const;
 	std::set<int>::const_iterator begin() const;
 	std::set<int>::const_iterator end() const;
-    const std::map<std::string, double>& GetWordFrequencies(int document_id) const;
+    WordFrequencies GetWordFrequencies(int document_id) const;
+    // термины словаря, начинающиеся с prefix, в лексикографическом порядке
+    std::vector<std::string_view> FindTermsByPrefix(const std::string_view prefix, size_t max_count = MAX_PREFIX_EXPANSION_COUNT) const;
+    // термины словаря на редакционном расстоянии не больше max_edit_distance от word: сначала ближайшие,
+    // при равном расстоянии — встречающиеся в большем числе документов; само word, если есть в словаре, первое
+    std::vector<std::string_view> FindTermsByEditDistance(const std::string_view word, int max_edit_distance, size_t max_count = MAX_FUZZY_EXPANSION_COUNT) const;
+    // 0 — точное совпадение плюс-слов, 1..MAX_FUZZY_EDIT_DISTANCE — нечёткий поиск
+    void SetFuzzyMatching(int max_edit_distance);
+    // ASCII-буквы документов, запросов и стоп-слов приводятся к нижнему регистру; только до добавления документов.
+    // Выключение возвращает стоп-слова в исходном регистре
+    void SetAsciiCaseFolding(bool enabled);
+    bool IsAsciiCaseFolding() const;
+    // переносит документы other, кроме excluded_ids, в этот сервер
+    void MergeFrom(const SearchServer& other, const std::set<int>& excluded_ids);
+    void MergeFrom(const SearchServer& other, const OrdinalBitmap& excluded_ordinals);
+    // отдаёт запас ёмкости списков документов; для сервера, который больше не меняется
+    void ShrinkToFit();
+    // переносит один документ other со статусом и оценками
+    void MergeDocument(const SearchServer& other, int document_id);
 	
 	void RemoveDocument(int document_id);
     void RemoveDocument(std::execution::parallel_policy, int document_id);
     void RemoveDocument(std::execution::sequenced_policy, int document_id);
+    // каждый затронутый список документов слова правится один раз
+    void RemoveDocuments(const std::vector<int>& document_ids);
+    void RemoveDocuments(std::execution::parallel_policy, const std::vector<int>& document_ids);
+    void RemoveDocuments(std::execution::sequenced_policy, const std::vector<int>& document_ids);
 
 private:
+	// загрузчик передаёт слова, уже разбитые SplitIntoWordsNoStop этого сервера
+	friend size_t IngestDocuments(SearchServer& search_server, int fd, size_t queue_capacity);
+
 	struct DocumentData {
+		// среднее rating_sum, хранится для предикатов поиска
 		int rating;
 		DocumentStatus status;
+		// плотный номер документа в порядке добавления, номера удалённых не переиспользуются
+		uint32_t ordinal;
+		RatingSum rating_sum;
 	};
-    const std::set<std::string> stop_words_;
-	std::map<std::string, std::map<int, double>> word_to_document_freqs_;
+    StopWordSet stop_words_;
+	// стоп-слова в исходном регистре, пока включено приведение регистра
+	std::optional<StopWordSet> original_stop_words_;
+	Dictionary word_to_document_freqs_;
+	// слово по term_id; итераторы std::map не инвалидируются при вставке
+	std::vector<Dictionary::iterator> terms_;
 	std::map<int, DocumentData> documents_;
-    std::map<int, std::map<std::string,double>>  id_freqs_word_;
+	// документ по номеру без поиска в documents_; ячейки удалённых документов не читаются
+	std::vector<std::map<int, DocumentData>::const_iterator> ordinal_documents_;
+	// прямой индекс, отсортирован по term_id
+	std::map<int, std::vector<TermFrequency>> id_freqs_word_;
 	std::set<int> document_ids_;
+	uint32_t ordinal_count_ = 0;
+	int fuzzy_edit_distance_ = 0;
+	bool ascii_case_folding_ = false;
 
-	bool IsStopWord(const std::string& word) const;
-	static bool IsValidWord(const std::string& word);
-    std::vector<std::string> SplitIntoWordsNoStop(const std::string_view text) const;
+	// Версия словаря для кэша нечётких расширений. Кэш у каждого потока свой и без блокировок;
+	// версия уникальна среди всех серверов и меняется при изменении словаря и при копировании,
+	// поэтому записи кэша, указывающие в чужой или устаревший словарь, никогда не находятся
+	class DictionaryVersion {
+	public:
+		DictionaryVersion();
+		DictionaryVersion(const DictionaryVersion&);
+		DictionaryVersion(DictionaryVersion&& other);
+		DictionaryVersion& operator=(const DictionaryVersion&) = delete;
+		void Advance();
+		uint64_t Get() const;
+
+	private:
+		uint64_t value_;
+	};
+	DictionaryVersion dictionary_version_;
+
+	// слова должны быть получены из SplitIntoWordsNoStop: ни проверки, ни стоп-слов здесь нет
+	void AddDocumentWords(int document_id, const std::vector<std::string_view>& words, DocumentStatus status, const std::vector<int>& ratings);
+	void UpdateDocumentWords(int document_id, const std::vector<std::string_view>& words, DocumentStatus status, const std::vector<int>& ratings);
+	Dictionary::iterator GetOrAddTerm(const std::string_view word);
+	void CopyDocument(const SearchServer& other, int document_id, const DocumentData& document_data);
+	// прямой индекс документа из слов: отсортирован по term_id, повторы сложены
+	std::vector<TermFrequency> ComputeTermFrequencies(const std::vector<std::string_view>& words);
+	// nullptr, если слова нет в словаре
+	const TermPostings* FindPostings(const std::string_view word) const;
+	bool HasWord(const std::string_view word, uint32_t ordinal) const;
+	bool IsStopWord(const std::string_view word) const;
+	static bool IsValidWord(const std::string_view word);
+	static StopWordSet MakeStopWords(const std::set<std::string, std::less<>>& stop_words);
 
 	struct QueryWord {
-		std::string data;
-		bool is_minus;
+		std::string_view data;
 		bool is_stop;
+		bool is_prefix;
+		double boost;
 	};
 
+	// Запрос: слова через пробел, +слово — обязательное, -слово — исключённое,
+	// (a | b) — группа, к которой относятся знак и множитель, слово^2.0 — множитель релевантности.
+	// План: обязательные группы пересекаются в список кандидатов, из него выбрасываются
+	// документы с минус-словами, затем по кандидатам считается релевантность plus_words.
+	// Слова указывают в текст запроса или в словарь, контейнеры — в память запроса
 	struct Query {
-        std::set<std::string, std::less<>> plus_words;
-        std::set<std::string, std::less<>> minus_words;
+		explicit Query(std::pmr::memory_resource* resource);
+		std::pmr::memory_resource* GetResource() const;
+
+        std::pmr::set<std::string_view> plus_words;
+        std::pmr::set<std::string_view> minus_words;
+		// слова с * и нечёткие слова до раскрытия
+		std::pmr::vector<std::string_view> prefix_words;
+		std::pmr::vector<std::string_view> fuzzy_words;
+		// множители релевантности, отличные от 1
+		std::pmr::map<std::string_view, double> boosts;
+		// документ должен содержать хотя бы одно слово каждой группы
+		std::pmr::vector<std::pmr::vector<std::string_view>> required_groups;
 	};
 
-    Query ParseQuery(const std::string_view text) const;
-	QueryWord ParseQueryWord(const std::string& text) const;
+	// при statistics слова раскрываются выбранными в ней терминами
+    Query ParseQuery(const std::string_view text, std::pmr::memory_resource* resource, const QueryStatistics* statistics = nullptr) const;
+	// text уже приведён к нижнему регистру, если это требуется
+    Query ParseFoldedQuery(const std::string_view text, std::pmr::memory_resource* resource, const QueryStatistics* statistics) const;
+	void ExpandFuzzy(const std::string_view word, std::pmr::vector<std::string_view>& terms) const;
+	// все термины на расстоянии fuzzy_edit_distance_, без ранжирования
+	std::vector<LevenshteinAutomaton::Match> FindFuzzyMatches(const std::string_view word, int max_edit_distance) const;
+	template <typename Terms>
+	void CollectTermsByPrefix(const std::string_view prefix, size_t max_count, Terms& terms) const;
+	// экранированное слово копируется без \ в resource
+	QueryWord ParseQueryWord(const std::string_view text, std::pmr::memory_resource* resource) const;
+	void AddQueryClause(const std::pmr::vector<QueryWord>& words, bool is_minus, bool is_required, const QueryStatistics* statistics,
+		Query& query) const;
+	// номера документов со всеми обязательными группами, по возрастанию
+	std::pmr::vector<uint32_t> FindRequiredDocuments(const Query& query) const;
+	bool HasRequiredWords(const Query& query, uint32_t ordinal) const;
+	// номера документов с минус-словами
+	OrdinalSet FindExcludedDocuments(const Query& query) const;
+	// Обход списка документов слова, callback(номер, частота); при candidates — только номера из candidates,
+	// они находятся ядром пересечения. Позиции размещаются в resource: у параллельного обхода не арена запроса
+	template <typename Callback>
+	void ForEachPosting(const TermPostings& postings, const std::pmr::vector<uint32_t>* candidates, std::pmr::memory_resource* resource,
+		Callback callback) const;
+
+	double ComputeWordInverseDocumentFreq(const std::string_view word, const QueryStatistics* statistics) const;
 
-	double ComputeWordInverseDocumentFreq(const std::string& word) const;
-	static int ComputeAverageRating(const std::vector<int>& ratings);
+	template <typename ExecutionPolicy>
+	void EraseDocuments(const ExecutionPolicy& policy, const std::vector<int>& document_ids);
 
 	template <typename DocumentPredicate, typename ExecutionPolicy>
-	std::vector<Document> FindAllDocuments(const ExecutionPolicy& policy, const Query& query, DocumentPredicate document_predicate) const;
+	std::vector<Document> SelectTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentPredicate document_predicate,
+		const QueryStatistics* statistics, const OrdinalBitmap* removed, QueryArena& arena) const;
+	template <typename DocumentPredicate, typename ExecutionPolicy>
+	std::pmr::vector<Document> FindAllDocuments(const ExecutionPolicy& policy, const Query& query, DocumentPredicate document_predicate,
+		const QueryStatistics* statistics, const OrdinalBitmap* removed, SearchPhaseTimer& timer) const;
 };
 
 void AddDocument(SearchServer& search_server, int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings);
@@ -93,50 +376,69 @@ void MatchDocuments(const SearchServer& search_server, const std::string& query)
 
 template <typename StringContainer>
 SearchServer::SearchServer(const StringContainer& stop_words)
-: stop_words_(MakeUniqueNonEmptyStrings(stop_words)){
-	if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
+: stop_words_(MakeStopWords(MakeUniqueNonEmptyStrings(stop_words))){
+}
+
+template <size_t N>
+SearchServer::SearchServer(const StaticStopWordSet<N>& stop_words)
+: stop_words_(stop_words) {
+	const auto& words = stop_words.GetWords();
+	if (!std::all_of(words.begin(), words.end(), IsValidWord)) {
 		throw std::invalid_argument("Some of stop words are invalid"s);
 	}
 }
 
 template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const {
-	const auto query = ParseQuery(raw_query);
-	auto matched_documents = FindAllDocuments(std::execution::seq, query, document_predicate);
-	sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-		if (std::abs(lhs.relevance - rhs.relevance) < 1e-6) {
-			return lhs.rating > rhs.rating;
-		} else {
-			return lhs.relevance > rhs.relevance;
-		}
-	});
-	if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-		matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-	}
-	return matched_documents;
+	return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
 }
 
 template <typename DocumentPredicate, typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentPredicate document_predicate) const {
+	return SelectTopDocuments(policy, raw_query, document_predicate, nullptr, nullptr, QueryArena::GetThreadArena());
+}
+
+template <typename DocumentPredicate, typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentPredicate document_predicate,
+const QueryStatistics& statistics) const {
+	return SelectTopDocuments(policy, raw_query, document_predicate, &statistics, nullptr, QueryArena::GetThreadArena());
+}
+
+template <typename DocumentPredicate, typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentPredicate document_predicate,
+const QueryStatistics& statistics, const OrdinalBitmap& removed) const {
+	return SelectTopDocuments(policy, raw_query, document_predicate, &statistics, &removed, QueryArena::GetThreadArena());
+}
+
+template <typename DocumentPredicate, typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentPredicate document_predicate,
+QueryArena& arena) const {
+	return SelectTopDocuments(policy, raw_query, document_predicate, nullptr, nullptr, arena);
+}
+
+template <typename DocumentPredicate, typename ExecutionPolicy>
+std::vector<Document> SearchServer::SelectTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentPredicate document_predicate,
+const QueryStatistics* statistics, const OrdinalBitmap* removed, QueryArena& arena) const {
+	SearchPhaseTimer timer;
+	// всё, что размещено в арене, уничтожается раньше её сброса в ~Scope
+	const QueryArena::Scope arena_scope(arena);
+	const Query query = ParseQuery(raw_query, arena_scope.GetResource(), statistics);
+	timer.Mark(SearchPhase::PARSE);
+	auto matched_documents = FindAllDocuments(policy, query, document_predicate, statistics, removed, timer);
 	if constexpr(std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
-		return FindTopDocuments(raw_query, document_predicate);
+		sort(matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
 	} else {
 		// paraleln algo
-		const auto query = ParseQuery(raw_query);
-		auto matched_documents = FindAllDocuments(policy, query, document_predicate);
-		std::sort(policy, matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-			if (std::abs(lhs.relevance - rhs.relevance) < 1e-6) {
-				return lhs.rating > rhs.rating;
-			} else {
-				return lhs.relevance > rhs.relevance;
-			}
-		});
-		if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-			matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-		}
-		return matched_documents;
+		std::sort(policy, matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
 	}
+	// из кучи выделяется только сам результат
+	std::vector<Document> top_documents(matched_documents.begin(),
+		matched_documents.begin() + std::min(matched_documents.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT)));
+	timer.Mark(SearchPhase::TOP_K);
+	timer.Finish();
+	return top_documents;
 }
+
 template <typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentStatus status) const {
 	return FindTopDocuments(policy, raw_query, [status](int, DocumentStatus document_status, int) {
@@ -149,61 +451,106 @@ template <typename ExecutionPolicy>
 }
 
 template <typename DocumentPredicate, typename ExecutionPolicy>
-std::vector<Document> SearchServer::FindAllDocuments(const ExecutionPolicy& policy, const Query& query, DocumentPredicate document_predicate) const {
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const ExecutionPolicy& policy, const Query& query, DocumentPredicate document_predicate,
+const QueryStatistics* statistics, const OrdinalBitmap* removed, SearchPhaseTimer& timer) const {
+	struct WordPostings {
+		const TermPostings* postings;
+		double inverse_document_freq;
+	};
+	std::pmr::memory_resource* const resource = query.GetResource();
+	std::pmr::vector<WordPostings> plus_postings(resource);
+	for (const std::string_view word : query.plus_words) {
+		if (const auto* postings = FindPostings(word)) {
+			const auto boost = query.boosts.find(word);
+			plus_postings.push_back({postings, ComputeWordInverseDocumentFreq(word, statistics)
+				* (boost == query.boosts.end() ? 1.0 : boost->second)});
+		}
+	}
+	std::pmr::vector<uint32_t> required_documents(resource);
+	const std::pmr::vector<uint32_t>* candidates = nullptr;
+	if (!query.required_groups.empty()) {
+		required_documents = FindRequiredDocuments(query);
+		candidates = &required_documents;
+	}
+	timer.Mark(SearchPhase::POSTINGS_FETCH);
+
+	// минус-слова вычисляются до подсчёта релевантности, исключённые и удалённые документы пропускаются сразу
+	const OrdinalSet excluded = FindExcludedDocuments(query);
+	const auto is_excluded = [&excluded, removed](uint32_t ordinal) {
+		return excluded.Contains(ordinal) || (removed && removed->Contains(ordinal));
+	};
+	timer.Mark(SearchPhase::FILTERING);
+
+	// считаются только посещённые ForEachPosting записи: при обязательных словах это пересечение с кандидатами,
+	// а оценёнными — записи, прошедшие минус-слова и предикат
+	std::pmr::vector<Document> matched_documents(resource);
+	uint64_t postings_scanned = 0;
+	uint64_t documents_scored = 0;
 	if constexpr(std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
-		std::map<int, double> document_to_relevance;
-		for (const std::string& word : query.plus_words) {
-			if (word_to_document_freqs_.count(word) == 0) {
-				continue;
-			}
-			const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-			for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-				const auto& document_data = documents_.at(document_id);
+		std::pmr::map<int, double> document_to_relevance(resource);
+		for (const auto [postings, inverse_document_freq] : plus_postings) {
+			ForEachPosting(*postings, candidates, resource, [&](uint32_t ordinal, double term_freq) {
+				++postings_scanned;
+				if (is_excluded(ordinal)) {
+					return;
+				}
+				const auto& [document_id, document_data] = *ordinal_documents_[ordinal];
 				if (document_predicate(document_id, document_data.status, document_data.rating)) {
 					document_to_relevance[document_id] += term_freq * inverse_document_freq;
+					++documents_scored;
 				}
-			}
+			});
 		}
-		for (const std::string& word : query.minus_words) {
-			if (word_to_document_freqs_.count(word) == 0) {
-				continue;
-			}
-			for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-				document_to_relevance.erase(document_id);
-			}
-		}
-		std::vector<Document> matched_documents;
+		matched_documents.reserve(document_to_relevance.size());
 		for (const auto [document_id, relevance] : document_to_relevance) {
 			matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
 		}
-		return matched_documents;
 	} else {
-		// paralelny algo
-		ConcurrentMap<int, double> document_to_relevance;
-		for (const std::string& word : query.plus_words) {
-			if (word_to_document_freqs_.count(word) == 0) {
-				continue;
-			}
-			const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-			for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-				const auto& document_data = documents_.at(document_id);
-				if (document_predicate(document_id, document_data.status, document_data.rating)) {
-					document_to_relevance[document_id] += term_freq * inverse_document_freq;
-				}
-			}
-		}
-		for (const std::string& word : query.minus_words) {
-			if (word_to_document_freqs_.count(word) == 0) {
-				continue;
-			}
-			for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-				document_to_relevance.erase(document_id);
-			}
-		}
-		std::vector<Document> matched_documents;
-		for (const auto [document_id, relevance] : document_to_relevance) {
+		// paralelny algo; корзины ConcurrentMap заполняются из разных потоков и в арену не попадают
+		ConcurrentMap<int, double> document_to_relevance(CONCURRENT_BUCKET_COUNT);
+		std::atomic<uint64_t> shared_postings_scanned{0};
+		std::atomic<uint64_t> shared_documents_scored{0};
+		std::for_each(policy, plus_postings.begin(), plus_postings.end(),
+			[&](const WordPostings& postings) {
+				uint64_t word_postings_scanned = 0;
+				uint64_t word_documents_scored = 0;
+				ForEachPosting(*postings.postings, candidates, std::pmr::get_default_resource(), [&](uint32_t ordinal, double term_freq) {
+					++word_postings_scanned;
+					if (is_excluded(ordinal)) {
+						return;
+					}
+					const auto& [document_id, document_data] = *ordinal_documents_[ordinal];
+					if (document_predicate(document_id, document_data.status, document_data.rating)) {
+						document_to_relevance[document_id].ref_to_value += term_freq * postings.inverse_document_freq;
+						++word_documents_scored;
+					}
+				});
+				shared_postings_scanned.fetch_add(word_postings_scanned, std::memory_order_relaxed);
+				shared_documents_scored.fetch_add(word_documents_scored, std::memory_order_relaxed);
+			});
+		postings_scanned = shared_postings_scanned.load(std::memory_order_relaxed);
+		documents_scored = shared_documents_scored.load(std::memory_order_relaxed);
+		for (const auto [document_id, relevance] : document_to_relevance.BuildOrdinaryMap()) {
 			matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
 		}
-		return matched_documents;
+	}
+	timer.Mark(SearchPhase::SCORING);
+	AddSearchCounters(postings_scanned, documents_scored);
+	return matched_documents;
+}
+
+template <typename Callback>
+void SearchServer::ForEachPosting(const TermPostings& postings, const std::pmr::vector<uint32_t>* candidates, std::pmr::memory_resource* resource,
+Callback callback) const {
+	if (!candidates) {
+		for (size_t i = 0; i < postings.size(); ++i) {
+			callback(postings.ordinals[i], postings.term_freqs[i]);
+		}
+		return;
+	}
+	std::pmr::vector<uint32_t> positions(std::min(candidates->size(), postings.size()) + 8, resource);
+	positions.resize(IntersectPositions(candidates->data(), candidates->size(), postings.ordinals.data(), postings.size(), positions.data()));
+	for (const uint32_t i : positions) {
+		callback(postings.ordinals[i], postings.term_freqs[i]);
 	}
 }
@@ -0,0 +1,218 @@
+#include "segmented_search_server.h"
+#include "profiler.h"
+#include <cmath>
+#include <limits>
+
+SegmentedSearchServer::SegmentedSearchServer(const std::string& stop_words_text, size_t segment_capacity, size_t merge_factor)
+: SegmentedSearchServer(SplitIntoWords(stop_words_text), segment_capacity, merge_factor) {
+}
+
+SegmentedSearchServer::SegmentedSearchServer(const std::string_view stop_words_text, size_t segment_capacity, size_t merge_factor)
+: SegmentedSearchServer(SplitIntoWords(stop_words_text), segment_capacity, merge_factor) {
+}
+
+SegmentedSearchServer::~SegmentedSearchServer() {
+	{
+		std::lock_guard guard(merge_mutex_);
+		stop_ = true;
+	}
+	merge_cv_.notify_all();
+	merge_thread_.join();
+}
+
+void SegmentedSearchServer::AddDocument(int document_id, const std::string_view& document, DocumentStatus status,
+const std::vector<int>& ratings) {
+	std::unique_lock guard(mutex_);
+	for (const SealedSegment& segment : sealed_) {
+		const auto ordinal = segment.index->FindDocumentOrdinal(document_id);
+		if (ordinal && !segment.removed.Contains(*ordinal)) {
+			throw std::invalid_argument("Invalid document_id"s);
+		}
+	}
+	active_->AddDocument(document_id, document, status, ratings);
+	if (static_cast<size_t>(active_->GetDocumentCount()) >= segment_capacity_) {
+		SealActiveSegment();
+	}
+}
+
+void SegmentedSearchServer::RemoveDocument(int document_id) {
+	std::unique_lock guard(mutex_);
+	if (active_->HasDocument(document_id)) {
+		active_->RemoveDocument(document_id);
+		return;
+	}
+	for (SealedSegment& segment : sealed_) {
+		const auto ordinal = segment.index->FindDocumentOrdinal(document_id);
+		if (!ordinal || segment.removed.Contains(*ordinal)) {
+			continue;
+		}
+		segment.removed.Insert(*ordinal);
+		segment.removed_ids.push_back(document_id);
+		++tombstone_count_;
+		for (const auto& [word, _] : segment.index->GetWordFrequencies(document_id)) {
+			++tombstone_document_freqs_[std::string(word)];
+		}
+	}
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const {
+	return FindTopDocuments(std::execution::seq, raw_query, status);
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(const std::string_view raw_query) const {
+	return FindTopDocuments(std::execution::seq, raw_query);
+}
+
+int SegmentedSearchServer::GetDocumentCount() const {
+	std::shared_lock guard(mutex_);
+	int document_count = active_->GetDocumentCount() - tombstone_count_;
+	for (const SealedSegment& segment : sealed_) {
+		document_count += segment.index->GetDocumentCount();
+	}
+	return document_count;
+}
+
+size_t SegmentedSearchServer::GetSegmentCount() const {
+	std::shared_lock guard(mutex_);
+	return sealed_.size();
+}
+
+void SegmentedSearchServer::WaitForMerges() {
+	std::unique_lock guard(merge_mutex_);
+	merge_cv_.wait(guard, [this] {
+		return !merge_requested_ && !merging_;
+	});
+}
+
+QueryStatistics SegmentedSearchServer::CollectQueryStatistics(const std::string_view raw_query) const {
+	QueryStatistics statistics = active_->CollectQueryStatistics(raw_query);
+	for (const SealedSegment& segment : sealed_) {
+		// префиксы сегмента с надгробиями раскрываются полностью, удалённые термины отсеет SelectExpansions
+		statistics.Add(segment.index->CollectQueryStatistics(raw_query,
+			segment.removed_ids.empty() ? MAX_PREFIX_EXPANSION_COUNT : std::numeric_limits<size_t>::max()));
+	}
+	statistics.document_count -= tombstone_count_;
+	for (auto& [word, document_freq] : statistics.document_freqs) {
+		const auto it = tombstone_document_freqs_.find(word);
+		if (it != tombstone_document_freqs_.end()) {
+			document_freq -= it->second;
+		}
+	}
+	// раскрытия выбираются по частотам без удалённых документов
+	statistics.SelectExpansions();
+	return statistics;
+}
+
+void SegmentedSearchServer::SealActiveSegment() {
+	active_->ShrinkToFit();
+	sealed_.push_back({std::move(active_), {}, {}});
+	active_ = std::make_unique<SearchServer>(empty_segment_);
+	{
+		std::lock_guard guard(merge_mutex_);
+		merge_requested_ = true;
+	}
+	merge_cv_.notify_all();
+}
+
+size_t SegmentedSearchServer::GetTier(const Segment& segment) const {
+	size_t tier = 0;
+	for (size_t size = segment_capacity_ * merge_factor_; size <= static_cast<size_t>(segment->GetDocumentCount()); size *= merge_factor_) {
+		++tier;
+	}
+	return tier;
+}
+
+SegmentedSearchServer::SealedSegment& SegmentedSearchServer::FindSealedSegment(const Segment& index) {
+	return *std::find_if(sealed_.begin(), sealed_.end(), [&index](const SealedSegment& segment) {
+		return segment.index == index;
+	});
+}
+
+std::vector<SegmentedSearchServer::Segment> SegmentedSearchServer::SelectMergeCandidates() const {
+	std::map<size_t, std::vector<Segment>> tiers;
+	for (const SealedSegment& segment : sealed_) {
+		auto& tier = tiers[GetTier(segment.index)];
+		tier.push_back(segment.index);
+		if (tier.size() == merge_factor_) {
+			return tier;
+		}
+	}
+	return {};
+}
+
+void SegmentedSearchServer::MergeSegments(const std::vector<Segment>& candidates) {
+	PROFILE_SCOPE("SegmentedSearchServer::MergeSegments");
+	std::vector<OrdinalBitmap> removed;
+	removed.reserve(candidates.size());
+	{
+		std::shared_lock guard(mutex_);
+		for (const Segment& segment : candidates) {
+			removed.push_back(FindSealedSegment(segment).removed);
+		}
+	}
+
+	// тяжёлая часть идёт без блокировки: запечатанные сегменты неизменяемы
+	auto merged = std::make_shared<SearchServer>(empty_segment_);
+	for (size_t i = 0; i < candidates.size(); ++i) {
+		merged->MergeFrom(*candidates[i], removed[i]);
+	}
+	merged->ShrinkToFit();
+
+	std::unique_lock guard(mutex_);
+	SealedSegment merged_segment{merged, {}, {}};
+	for (size_t i = 0; i < candidates.size(); ++i) {
+		const SealedSegment& segment = FindSealedSegment(candidates[i]);
+		for (const int document_id : segment.removed_ids) {
+			if (!removed[i].Contains(*segment.index->FindDocumentOrdinal(document_id))) {
+				// удалён во время слияния
+				merged_segment.removed.Insert(*merged->FindDocumentOrdinal(document_id));
+				merged_segment.removed_ids.push_back(document_id);
+				continue;
+			}
+			--tombstone_count_;
+			for (const auto& [word, _] : segment.index->GetWordFrequencies(document_id)) {
+				const auto word_it = tombstone_document_freqs_.find(word);
+				if (--word_it->second == 0) {
+					tombstone_document_freqs_.erase(word_it);
+				}
+			}
+		}
+		sealed_.erase(sealed_.begin() + (&segment - sealed_.data()));
+	}
+	sealed_.push_back(std::move(merged_segment));
+}
+
+void SegmentedSearchServer::RunMerges() {
+	std::unique_lock merge_guard(merge_mutex_);
+	while (true) {
+		merge_cv_.wait(merge_guard, [this] {
+			return stop_ || merge_requested_;
+		});
+		if (stop_) {
+			return;
+		}
+		merge_requested_ = false;
+		merging_ = true;
+		merge_guard.unlock();
+
+		while (true) {
+			std::vector<Segment> candidates;
+			{
+				std::shared_lock guard(mutex_);
+				candidates = SelectMergeCandidates();
+			}
+			if (candidates.empty()) {
+				break;
+			}
+			MergeSegments(candidates);
+			std::lock_guard guard(merge_mutex_);
+			if (stop_) {
+				break;
+			}
+		}
+
+		merge_guard.lock();
+		merging_ = false;
+		merge_cv_.notify_all();
+	}
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include "search_server.h"
+
+const size_t DEFAULT_SEGMENT_CAPACITY = 10'000;
+const size_t DEFAULT_MERGE_FACTOR = 4;
+
+// Индекс из изменяемого сегмента и неизменяемых запечатанных сегментов.
+// Новые документы пишутся в изменяемый сегмент, заполненный сегмент запечатывается.
+// Запечатанный сегмент сжимается и больше не меняется: удаление из него оставляет надгробие —
+// бит порядкового номера документа, который поиск проверяет вместе с минус-словами. Фоновый поток сливает
+// по merge_factor сегментов одного уровня (tiered merge) и выбрасывает удалённые документы.
+// Запрос выполняется по всем сегментам, топы сливаются; IDF считается по всему индексу
+// без учёта удалённых документов, поэтому релевантность совпадает с единым SearchServer.
+class SegmentedSearchServer {
+public:
+	template <typename StringContainer>
+	explicit SegmentedSearchServer(const StringContainer& stop_words, size_t segment_capacity = DEFAULT_SEGMENT_CAPACITY,
+		size_t merge_factor = DEFAULT_MERGE_FACTOR);
+	explicit SegmentedSearchServer(const std::string& stop_words_text, size_t segment_capacity = DEFAULT_SEGMENT_CAPACITY,
+		size_t merge_factor = DEFAULT_MERGE_FACTOR);
+	explicit SegmentedSearchServer(const std::string_view stop_words_text, size_t segment_capacity = DEFAULT_SEGMENT_CAPACITY,
+		size_t merge_factor = DEFAULT_MERGE_FACTOR);
+	~SegmentedSearchServer();
+
+	void AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings);
+	void RemoveDocument(int document_id);
+
+	template <typename DocumentPredicate, typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentPredicate document_predicate) const;
+	template <typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentStatus status) const;
+	template <typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query) const;
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const;
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const;
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query) const;
+
+	int GetDocumentCount() const;
+	// число запечатанных сегментов
+	size_t GetSegmentCount() const;
+	// ждёт, пока фоновый поток не выполнит все доступные слияния
+	void WaitForMerges();
+
+private:
+	using Segment = std::shared_ptr<const SearchServer>;
+	struct SealedSegment {
+		Segment index;
+		// надгробия по порядковым номерам index и те же документы по id для слияния
+		OrdinalBitmap removed;
+		std::vector<int> removed_ids;
+	};
+
+	const SearchServer empty_segment_;
+	const size_t segment_capacity_;
+	const size_t merge_factor_;
+
+	mutable std::shared_mutex mutex_;
+	std::unique_ptr<SearchServer> active_;
+	std::vector<SealedSegment> sealed_;
+	int tombstone_count_ = 0;
+	// в скольких удалённых документах встречается слово
+	std::map<std::string, int, std::less<>> tombstone_document_freqs_;
+
+	std::mutex merge_mutex_;
+	std::condition_variable merge_cv_;
+	bool merge_requested_ = false;
+	bool merging_ = false;
+	bool stop_ = false;
+	std::thread merge_thread_;
+
+	void SealActiveSegment();
+	size_t GetTier(const Segment& segment) const;
+	SealedSegment& FindSealedSegment(const Segment& index);
+	std::vector<Segment> SelectMergeCandidates() const;
+	void MergeSegments(const std::vector<Segment>& candidates);
+	void RunMerges();
+	QueryStatistics CollectQueryStatistics(const std::string_view raw_query) const;
+};
+
+template <typename StringContainer>
+SegmentedSearchServer::SegmentedSearchServer(const StringContainer& stop_words, size_t segment_capacity, size_t merge_factor)
+: empty_segment_(stop_words)
+, segment_capacity_(std::max<size_t>(segment_capacity, 1))
+, merge_factor_(std::max<size_t>(merge_factor, 2))
+, active_(std::make_unique<SearchServer>(empty_segment_))
+, merge_thread_([this] { RunMerges(); }) {
+}
+
+template <typename DocumentPredicate, typename ExecutionPolicy>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query,
+DocumentPredicate document_predicate) const {
+	std::shared_lock guard(mutex_);
+	const QueryStatistics statistics = CollectQueryStatistics(raw_query);
+	std::vector<std::vector<Document>> top_documents(sealed_.size() + 1);
+	top_documents.back() = active_->FindTopDocuments(policy, raw_query, document_predicate, statistics);
+	std::transform(policy, sealed_.begin(), sealed_.end(), top_documents.begin(),
+		[&](const SealedSegment& segment) {
+			return segment.index->FindTopDocuments(policy, raw_query, document_predicate, statistics, segment.removed);
+		});
+	return MergeTopDocuments(top_documents);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query,
+DocumentStatus status) const {
+	return FindTopDocuments(policy, raw_query, [status](int, DocumentStatus document_status, int) {
+		return document_status == status;
+	});
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query) const {
+	return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const {
+	return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+}
@@ -0,0 +1,182 @@
+#include "sharded_search_server.h"
+
+ShardedSearchServer::ShardedSearchServer(const std::string& stop_words_text, size_t shard_count, ShardPlacement placement)
+: ShardedSearchServer(SplitIntoWords(stop_words_text), shard_count, placement) {
+}
+
+ShardedSearchServer::ShardedSearchServer(const std::string_view stop_words_text, size_t shard_count, ShardPlacement placement)
+: ShardedSearchServer(SplitIntoWords(stop_words_text), shard_count, placement) {
+}
+
+void ShardedSearchServer::AddDocument(int document_id, const std::string_view& document, DocumentStatus status,
+const std::vector<int>& ratings) {
+	const size_t index = GetShardIndex(document_id);
+	if (node_pools_.empty()) {
+		shards_[index].AddDocument(document_id, document, status, ratings);
+	} else {
+		// память индекса выделяется потоком узла, которому принадлежит шард
+		RunOnShardNode(index, [&] {
+			shards_[index].AddDocument(document_id, document, status, ratings);
+		}).get();
+	}
+	document_ids_.insert(document_id);
+}
+
+void ShardedSearchServer::AddDocuments(const std::vector<DocumentInput>& documents) {
+	std::vector<std::vector<const DocumentInput*>> shard_documents(shards_.size());
+	for (const DocumentInput& document : documents) {
+		shard_documents[GetShardIndex(document.id)].push_back(&document);
+	}
+	std::vector<std::future<void>> tasks;
+	for (size_t i = 0; i < shards_.size(); ++i) {
+		tasks.push_back(RunOnShardNode(i, [this, i, &shard_documents] {
+			for (const DocumentInput* document : shard_documents[i]) {
+				shards_[i].AddDocument(document->id, document->text, document->status, document->ratings);
+			}
+		}));
+	}
+	// при ошибке документы, добавленные до неё, остаются в индексе
+	for (auto& task : tasks) {
+		task.wait();
+	}
+	for (const DocumentInput& document : documents) {
+		if (shards_[GetShardIndex(document.id)].HasDocument(document.id)) {
+			document_ids_.insert(document.id);
+		}
+	}
+	for (auto& task : tasks) {
+		task.get();
+	}
+}
+
+void ShardedSearchServer::AddRatings(int document_id, const std::vector<int>& ratings) {
+	shards_[GetShardIndex(document_id)].AddRatings(document_id, ratings);
+}
+
+void ShardedSearchServer::UpdateDocument(int document_id, const std::string_view& document, DocumentStatus status,
+const std::vector<int>& ratings) {
+	const size_t index = GetShardIndex(document_id);
+	if (node_pools_.empty()) {
+		shards_[index].UpdateDocument(document_id, document, status, ratings);
+	} else {
+		// новые слова попадают в память узла шарда, как при AddDocument
+		RunOnShardNode(index, [&] {
+			shards_[index].UpdateDocument(document_id, document, status, ratings);
+		}).get();
+	}
+}
+
+void ShardedSearchServer::SetStatus(int document_id, DocumentStatus status) {
+	shards_[GetShardIndex(document_id)].SetStatus(document_id, status);
+}
+
+void ShardedSearchServer::SetFuzzyMatching(int max_edit_distance) {
+	for (SearchServer& shard : shards_) {
+		shard.SetFuzzyMatching(max_edit_distance);
+	}
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const {
+	return FindTopDocuments(std::execution::seq, raw_query, status);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view raw_query) const {
+	return FindTopDocuments(std::execution::seq, raw_query);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(const std::string_view raw_query,
+int document_id) const {
+	return shards_[GetShardIndex(document_id)].MatchDocument(raw_query, document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(std::execution::parallel_policy policy,
+const std::string_view raw_query, int document_id) const {
+	return shards_[GetShardIndex(document_id)].MatchDocument(policy, raw_query, document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(std::execution::sequenced_policy policy,
+const std::string_view raw_query, int document_id) const {
+	return shards_[GetShardIndex(document_id)].MatchDocument(policy, raw_query, document_id);
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+	return document_ids_.size();
+}
+
+std::set<int>::const_iterator ShardedSearchServer::begin() const {
+	return document_ids_.cbegin();
+}
+
+std::set<int>::const_iterator ShardedSearchServer::end() const {
+	return document_ids_.cend();
+}
+
+SearchServer::WordFrequencies ShardedSearchServer::GetWordFrequencies(int document_id) const {
+	return shards_[GetShardIndex(document_id)].GetWordFrequencies(document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+	shards_[GetShardIndex(document_id)].RemoveDocument(document_id);
+	document_ids_.erase(document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(std::execution::parallel_policy policy, int document_id) {
+	shards_[GetShardIndex(document_id)].RemoveDocument(policy, document_id);
+	document_ids_.erase(document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(std::execution::sequenced_policy policy, int document_id) {
+	shards_[GetShardIndex(document_id)].RemoveDocument(policy, document_id);
+	document_ids_.erase(document_id);
+}
+
+void ShardedSearchServer::RemoveDocuments(const std::vector<int>& document_ids) {
+	std::vector<std::vector<int>> shard_documents(shards_.size());
+	for (const int document_id : document_ids) {
+		shard_documents[GetShardIndex(document_id)].push_back(document_id);
+		document_ids_.erase(document_id);
+	}
+	// как и вставка, правка шарда выполняется потоками его узла
+	std::vector<std::future<void>> tasks;
+	for (size_t i = 0; i < shards_.size(); ++i) {
+		if (!shard_documents[i].empty()) {
+			tasks.push_back(RunOnShardNode(i, [this, i, &shard_documents] {
+				shards_[i].RemoveDocuments(std::execution::seq, shard_documents[i]);
+			}));
+		}
+	}
+	for (auto& task : tasks) {
+		task.wait();
+	}
+	for (auto& task : tasks) {
+		task.get();
+	}
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+	return shards_.size();
+}
+
+const SearchServer& ShardedSearchServer::GetShard(size_t index) const {
+	return shards_.at(index);
+}
+
+size_t ShardedSearchServer::GetShardNode(size_t index) const {
+	return node_pools_.empty() ? 0 : index % node_pools_.size();
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const {
+	// перемешивание битов, чтобы подряд идущие id расходились по разным шардам
+	uint64_t hash = static_cast<uint64_t>(document_id) * 0x9E3779B97F4A7C15ull;
+	hash ^= hash >> 32;
+	return hash % shards_.size();
+}
+
+QueryStatistics ShardedSearchServer::CollectQueryStatistics(const std::string_view raw_query) const {
+	QueryStatistics statistics;
+	for (const SearchServer& shard : shards_) {
+		statistics.Add(shard.CollectQueryStatistics(raw_query));
+	}
+	statistics.SelectExpansions();
+	return statistics;
+}
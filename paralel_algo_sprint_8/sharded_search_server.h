@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include "numa_placement.h"
+#include "search_server.h"
+
+struct DocumentInput {
+	int id = 0;
+	std::string_view text;
+	DocumentStatus status = DocumentStatus::ACTUAL;
+	std::vector<int> ratings;
+};
+
+enum class ShardPlacement {
+	ANY,
+	// шард i живёт на узле i % число узлов: его память выделяется на этом узле,
+	// а вставка и поиск по нему выполняются потоками, привязанными к узлу
+	NUMA_NODES,
+};
+
+// Документы распределяются по shard_count серверам по хэшу id.
+// Запрос рассылается по шардам параллельно, топы шардов сливаются;
+// IDF и раскрытия слов с * и нечётких слов считаются по статистике всех шардов,
+// поэтому результаты совпадают с единым SearchServer. Политика выполнения относится к поиску
+// внутри шарда; в режиме ShardPlacement::NUMA_NODES шард ищется последовательно потоком своего узла.
+class ShardedSearchServer {
+public:
+	template <typename StringContainer>
+	ShardedSearchServer(const StringContainer& stop_words, size_t shard_count, ShardPlacement placement = ShardPlacement::ANY);
+	ShardedSearchServer(const std::string& stop_words_text, size_t shard_count, ShardPlacement placement = ShardPlacement::ANY);
+	ShardedSearchServer(const std::string_view stop_words_text, size_t shard_count, ShardPlacement placement = ShardPlacement::ANY);
+
+	void AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings);
+	// шарды заполняются параллельно
+	void AddDocuments(const std::vector<DocumentInput>& documents);
+	void AddRatings(int document_id, const std::vector<int>& ratings);
+	void UpdateDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings);
+	void SetStatus(int document_id, DocumentStatus status);
+	void SetFuzzyMatching(int max_edit_distance);
+
+	template <typename DocumentPredicate, typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentPredicate document_predicate) const;
+	template <typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentStatus status) const;
+	template <typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query) const;
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const;
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const;
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query) const;
+
+	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view raw_query, int document_id) const;
+	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::execution::parallel_policy, const std::string_view raw_query, int document_id) const;
+	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::execution::sequenced_policy, const std::string_view raw_query, int document_id) const;
+
+	int GetDocumentCount() const;
+	std::set<int>::const_iterator begin() const;
+	std::set<int>::const_iterator end() const;
+	SearchServer::WordFrequencies GetWordFrequencies(int document_id) const;
+
+	void RemoveDocument(int document_id);
+	void RemoveDocument(std::execution::parallel_policy, int document_id);
+	void RemoveDocument(std::execution::sequenced_policy, int document_id);
+	// шарды чистятся параллельно
+	void RemoveDocuments(const std::vector<int>& document_ids);
+
+	size_t GetShardCount() const;
+	const SearchServer& GetShard(size_t index) const;
+	// узел NUMA шарда; в режиме ShardPlacement::ANY всегда 0
+	size_t GetShardNode(size_t index) const;
+
+private:
+	std::vector<SearchServer> shards_;
+	std::set<int> document_ids_;
+	// пулы потоков по узлам NUMA, пусто в режиме ShardPlacement::ANY
+	std::vector<std::unique_ptr<NodeThreadPool>> node_pools_;
+
+	size_t GetShardIndex(int document_id) const;
+	template <typename Function>
+	auto RunOnShardNode(size_t index, Function function) const -> std::future<decltype(function())>;
+	QueryStatistics CollectQueryStatistics(const std::string_view raw_query) const;
+};
+
+template <typename StringContainer>
+ShardedSearchServer::ShardedSearchServer(const StringContainer& stop_words, size_t shard_count, ShardPlacement placement)
+: shards_(std::max<size_t>(shard_count, 1), SearchServer(stop_words)) {
+	if (placement == ShardPlacement::NUMA_NODES) {
+		const auto& nodes = GetNumaNodeCpus();
+		for (size_t node = 0; node < std::min(nodes.size(), shards_.size()); ++node) {
+			node_pools_.push_back(std::make_unique<NodeThreadPool>(node, nodes[node].size()));
+		}
+	}
+}
+
+template <typename Function>
+auto ShardedSearchServer::RunOnShardNode(size_t index, Function function) const -> std::future<decltype(function())> {
+	if (node_pools_.empty()) {
+		return std::async(std::launch::async, std::move(function));
+	}
+	return node_pools_[GetShardNode(index)]->Submit(std::move(function));
+}
+
+template <typename DocumentPredicate, typename ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query,
+DocumentPredicate document_predicate) const {
+	// некорректный запрос бросает исключение здесь, до параллельной части
+	const QueryStatistics statistics = CollectQueryStatistics(raw_query);
+	std::vector<std::vector<Document>> top_documents(shards_.size());
+	if (node_pools_.empty()) {
+		std::transform(std::execution::par, shards_.begin(), shards_.end(), top_documents.begin(),
+			[&](const SearchServer& shard) {
+				return shard.FindTopDocuments(policy, raw_query, document_predicate, statistics);
+			});
+	} else {
+		std::vector<std::future<std::vector<Document>>> shard_results;
+		for (size_t i = 0; i < shards_.size(); ++i) {
+			// потоки TBB не привязаны к узлу, поэтому поиск внутри шарда последовательный, в потоке узла
+			shard_results.push_back(RunOnShardNode(i, [&, i] {
+				return shards_[i].FindTopDocuments(std::execution::seq, raw_query, document_predicate, statistics);
+			}));
+		}
+		for (size_t i = 0; i < shards_.size(); ++i) {
+			top_documents[i] = shard_results[i].get();
+		}
+	}
+	return MergeTopDocuments(top_documents);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query,
+DocumentStatus status) const {
+	return FindTopDocuments(policy, raw_query, [status](int, DocumentStatus document_status, int) {
+		return document_status == status;
+	});
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query) const {
+	return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const {
+	return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+}
@@ -0,0 +1,248 @@
+#include "snapshot_search_server.h"
+#include "profiler.h"
+#include <limits>
+
+std::vector<Document> IndexSnapshot::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const {
+	return FindTopDocuments(std::execution::seq, raw_query, status);
+}
+
+std::vector<Document> IndexSnapshot::FindTopDocuments(const std::string_view raw_query) const {
+	return FindTopDocuments(std::execution::seq, raw_query);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> IndexSnapshot::MatchDocument(const std::string_view raw_query,
+int document_id) const {
+	const size_t index = FindSegment(document_id);
+	if (index == segments_.size()) {
+		throw std::out_of_range("Invalid document_id"s);
+	}
+	return segments_[index].server->MatchDocument(raw_query, document_id);
+}
+
+int IndexSnapshot::GetDocumentCount() const {
+	int document_count = -removed_count_;
+	for (const Segment& segment : segments_) {
+		document_count += segment.server->GetDocumentCount();
+	}
+	return document_count;
+}
+
+bool IndexSnapshot::HasDocument(int document_id) const {
+	return FindSegment(document_id) != segments_.size();
+}
+
+size_t IndexSnapshot::GetSegmentCount() const {
+	return segments_.size();
+}
+
+size_t IndexSnapshot::FindSegment(int document_id) const {
+	for (size_t i = 0; i < segments_.size(); ++i) {
+		const Segment& segment = segments_[i];
+		if (segment.server->HasDocument(document_id) && !(segment.removed && segment.removed->count(document_id))) {
+			return i;
+		}
+	}
+	return segments_.size();
+}
+
+QueryStatistics IndexSnapshot::CollectQueryStatistics(const std::string_view raw_query) const {
+	QueryStatistics statistics;
+	for (const Segment& segment : segments_) {
+		// термины только удалённых документов не должны вытеснять живые из первых по алфавиту
+		const bool has_removed = segment.removed && !segment.removed->empty();
+		statistics.Add(segment.server->CollectQueryStatistics(raw_query,
+			has_removed ? std::numeric_limits<size_t>::max() : MAX_PREFIX_EXPANSION_COUNT));
+	}
+	statistics.document_count -= removed_count_;
+	for (auto& [word, document_freq] : statistics.document_freqs) {
+		const auto it = removed_document_freqs_->find(word);
+		if (it != removed_document_freqs_->end()) {
+			document_freq -= it->second;
+		}
+	}
+	// раскрытия выбираются по частотам без удалённых документов
+	statistics.SelectExpansions();
+	return statistics;
+}
+
+SnapshotSearchServer::SnapshotSearchServer(const std::string& stop_words_text)
+: SnapshotSearchServer(SplitIntoWords(stop_words_text)) {
+}
+
+SnapshotSearchServer::SnapshotSearchServer(const std::string_view stop_words_text)
+: SnapshotSearchServer(SplitIntoWords(stop_words_text)) {
+}
+
+void SnapshotSearchServer::AddDocument(int document_id, const std::string_view& document, DocumentStatus status,
+const std::vector<int>& ratings) {
+	std::lock_guard guard(writer_mutex_);
+	if (next_.HasDocument(document_id)) {
+		throw std::invalid_argument("Invalid document_id"s);
+	}
+	draft_->AddDocument(document_id, document, status, ratings);
+	has_changes_ = true;
+}
+
+void SnapshotSearchServer::AddRatings(int document_id, const std::vector<int>& ratings) {
+	std::lock_guard guard(writer_mutex_);
+	TakeDocument(document_id).AddRatings(document_id, ratings);
+	has_changes_ = true;
+}
+
+void SnapshotSearchServer::UpdateDocument(int document_id, const std::string_view& document, DocumentStatus status,
+const std::vector<int>& ratings) {
+	std::lock_guard guard(writer_mutex_);
+	if (draft_->HasDocument(document_id)) {
+		draft_->UpdateDocument(document_id, document, status, ratings);
+	} else {
+		const size_t index = next_.FindSegment(document_id);
+		if (index == next_.segments_.size()) {
+			throw std::invalid_argument("Invalid document_id"s);
+		}
+		// новый текст индексируется до пометки, чтобы ошибка разбора ничего не меняла
+		draft_->AddDocument(document_id, document, status, ratings);
+		MarkRemoved(index, document_id);
+	}
+	has_changes_ = true;
+}
+
+void SnapshotSearchServer::SetStatus(int document_id, DocumentStatus status) {
+	std::lock_guard guard(writer_mutex_);
+	TakeDocument(document_id).SetStatus(document_id, status);
+	has_changes_ = true;
+}
+
+void SnapshotSearchServer::RemoveDocument(int document_id) {
+	std::lock_guard guard(writer_mutex_);
+	if (draft_->HasDocument(document_id)) {
+		draft_->RemoveDocument(document_id);
+		has_changes_ = true;
+		return;
+	}
+	const size_t index = next_.FindSegment(document_id);
+	if (index != next_.segments_.size()) {
+		MarkRemoved(index, document_id);
+		has_changes_ = true;
+	}
+}
+
+void SnapshotSearchServer::SetFuzzyMatching(int max_edit_distance) {
+	std::lock_guard guard(writer_mutex_);
+	empty_segment_.SetFuzzyMatching(max_edit_distance);
+	draft_->SetFuzzyMatching(max_edit_distance);
+	// настройка хранится в сегменте, поэтому запечатанные сегменты копируются
+	for (IndexSnapshot::Segment& segment : next_.segments_) {
+		auto server = std::make_shared<SearchServer>(*segment.server);
+		server->SetFuzzyMatching(max_edit_distance);
+		const auto it = owned_removed_.find(segment.server.get());
+		if (it != owned_removed_.end()) {
+			auto removed = it->second;
+			owned_removed_.erase(it);
+			owned_removed_.emplace(server.get(), std::move(removed));
+		}
+		segment.server = std::move(server);
+	}
+	has_changes_ = true;
+}
+
+void SnapshotSearchServer::Publish() {
+	PROFILE_SCOPE("SnapshotSearchServer::Publish");
+	std::lock_guard guard(writer_mutex_);
+	if (!has_changes_) {
+		return;
+	}
+	if (draft_->GetDocumentCount() > 0) {
+		next_.segments_.push_back({std::move(draft_), nullptr});
+		draft_ = std::make_unique<SearchServer>(empty_segment_);
+		MergeLastSegments();
+	}
+	auto version = std::make_shared<const IndexSnapshot>(next_);
+	current_.store(version.get());
+	// читатели, успевшие взять прежнюю версию, выходят из неё до её освобождения
+	rcu_.Synchronize();
+	published_ = std::move(version);
+	// опубликованные списки удалённых больше не меняются на месте
+	owned_removed_.clear();
+	owned_removed_document_freqs_.reset();
+	has_changes_ = false;
+}
+
+std::shared_ptr<const IndexSnapshot> SnapshotSearchServer::GetSnapshot() const {
+	const RcuDomain::ReadGuard guard(rcu_);
+	return current_.load()->shared_from_this();
+}
+
+int SnapshotSearchServer::GetDocumentCount() const {
+	const RcuDomain::ReadGuard guard(rcu_);
+	return current_.load()->GetDocumentCount();
+}
+
+void SnapshotSearchServer::MarkRemoved(size_t segment_index, int document_id) {
+	GetOwnedRemoved(segment_index).insert(document_id);
+	++next_.removed_count_;
+	auto& removed_document_freqs = GetOwnedRemovedDocumentFreqs();
+	for (const auto& [word, _] : next_.segments_[segment_index].server->GetWordFrequencies(document_id)) {
+		++removed_document_freqs[std::string(word)];
+	}
+}
+
+std::set<int>& SnapshotSearchServer::GetOwnedRemoved(size_t segment_index) {
+	IndexSnapshot::Segment& segment = next_.segments_[segment_index];
+	auto& owned = owned_removed_[segment.server.get()];
+	if (!owned) {
+		owned = segment.removed ? std::make_shared<std::set<int>>(*segment.removed) : std::make_shared<std::set<int>>();
+		segment.removed = owned;
+	}
+	return *owned;
+}
+
+std::map<std::string, int, std::less<>>& SnapshotSearchServer::GetOwnedRemovedDocumentFreqs() {
+	if (!owned_removed_document_freqs_) {
+		owned_removed_document_freqs_ = std::make_shared<std::map<std::string, int, std::less<>>>(*next_.removed_document_freqs_);
+		next_.removed_document_freqs_ = owned_removed_document_freqs_;
+	}
+	return *owned_removed_document_freqs_;
+}
+
+SearchServer& SnapshotSearchServer::TakeDocument(int document_id) {
+	if (draft_->HasDocument(document_id)) {
+		return *draft_;
+	}
+	const size_t index = next_.FindSegment(document_id);
+	if (index == next_.segments_.size()) {
+		throw std::invalid_argument("Invalid document_id"s);
+	}
+	draft_->MergeDocument(*next_.segments_[index].server, document_id);
+	MarkRemoved(index, document_id);
+	return *draft_;
+}
+
+void SnapshotSearchServer::MergeLastSegments() {
+	auto& segments = next_.segments_;
+	while (segments.size() >= 2 && segments[segments.size() - 2].server->GetDocumentCount()
+		<= SNAPSHOT_MERGE_RATIO * segments.back().server->GetDocumentCount()) {
+		auto merged = std::make_shared<SearchServer>(empty_segment_);
+		for (size_t i = segments.size() - 2; i < segments.size(); ++i) {
+			const IndexSnapshot::Segment& segment = segments[i];
+			if (!segment.removed) {
+				merged->MergeFrom(*segment.server, std::set<int>{});
+				continue;
+			}
+			merged->MergeFrom(*segment.server, *segment.removed);
+			// удалённые документы выбрасываются, их слова больше не вычитаются из статистики
+			auto& removed_document_freqs = GetOwnedRemovedDocumentFreqs();
+			for (const int document_id : *segment.removed) {
+				--next_.removed_count_;
+				for (const auto& [word, _] : segment.server->GetWordFrequencies(document_id)) {
+					const auto it = removed_document_freqs.find(word);
+					if (--it->second == 0) {
+						removed_document_freqs.erase(it);
+					}
+				}
+			}
+			owned_removed_.erase(segment.server.get());
+		}
+		segments.resize(segments.size() - 2);
+		segments.push_back({std::move(merged), nullptr});
+	}
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include "rcu_domain.h"
+#include "search_server.h"
+
+// при публикации последний сегмент сливается с предыдущим, пока тот не больше чем во столько раз крупнее
+const int SNAPSHOT_MERGE_RATIO = 2;
+
+// Неизменяемая версия индекса: запечатанные сегменты и удалённые из них документы.
+// Соседние версии делят неизменённые сегменты и списки удалённых. IDF считается по всем
+// сегментам без удалённых документов, поэтому релевантность совпадает с единым SearchServer
+class IndexSnapshot : public std::enable_shared_from_this<IndexSnapshot> {
+public:
+	template <typename DocumentPredicate, typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentPredicate document_predicate) const;
+	template <typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentStatus status) const;
+	template <typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query) const;
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const;
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const;
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query) const;
+
+	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view raw_query, int document_id) const;
+	int GetDocumentCount() const;
+	bool HasDocument(int document_id) const;
+	size_t GetSegmentCount() const;
+
+private:
+	friend class SnapshotSearchServer;
+
+	struct Segment {
+		std::shared_ptr<const SearchServer> server;
+		// удалённые из сегмента документы, nullptr — таких нет
+		std::shared_ptr<const std::set<int>> removed;
+	};
+
+	std::vector<Segment> segments_;
+	int removed_count_ = 0;
+	// в скольких удалённых документах встречается слово
+	std::shared_ptr<const std::map<std::string, int, std::less<>>> removed_document_freqs_;
+
+	// сегмент, где document_id не удалён; segments_.size(), если такого нет
+	size_t FindSegment(int document_id) const;
+	QueryStatistics CollectQueryStatistics(const std::string_view raw_query) const;
+};
+
+// Поиск по неизменяемым версиям индекса (RCU).
+// Писатель копит изменения в черновике под мьютексом. Publish запечатывает черновик
+// в новый сегмент и публикует версию заменой атомарного указателя; неизменённые сегменты
+// новая версия берёт из прежней, поэтому стоимость публикации — объём изменений, а не корпуса.
+// Читатели не берут блокировок: запрос отмечается в RcuDomain, прежняя версия
+// освобождается после того, как из неё выйдут все начавшие чтение
+class SnapshotSearchServer {
+public:
+	template <typename StringContainer>
+	explicit SnapshotSearchServer(const StringContainer& stop_words);
+	explicit SnapshotSearchServer(const std::string& stop_words_text);
+	explicit SnapshotSearchServer(const std::string_view stop_words_text);
+
+	// изменения не видны читателям до вызова Publish
+	void AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings);
+	void AddRatings(int document_id, const std::vector<int>& ratings);
+	void UpdateDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings);
+	void SetStatus(int document_id, DocumentStatus status);
+	void RemoveDocument(int document_id);
+	// перестраивает все сегменты
+	void SetFuzzyMatching(int max_edit_distance);
+	void Publish();
+
+	// версию нужно удерживать, пока используются string_view, полученные из неё
+	std::shared_ptr<const IndexSnapshot> GetSnapshot() const;
+
+	template <typename... Args>
+	std::vector<Document> FindTopDocuments(const Args&... args) const;
+	int GetDocumentCount() const;
+
+private:
+	std::mutex writer_mutex_;
+	// пустой сервер со стоп-словами и настройками — образец для новых сегментов
+	SearchServer empty_segment_;
+	std::unique_ptr<SearchServer> draft_;
+	// следующая версия без черновика; её сегменты общие с опубликованной
+	IndexSnapshot next_;
+	// списки удалённых, скопированные после публикации: их можно менять на месте
+	std::map<const SearchServer*, std::shared_ptr<std::set<int>>> owned_removed_;
+	std::shared_ptr<std::map<std::string, int, std::less<>>> owned_removed_document_freqs_;
+	bool has_changes_ = false;
+
+	RcuDomain rcu_;
+	std::atomic<const IndexSnapshot*> current_;
+	// удерживает опубликованную версию
+	std::shared_ptr<const IndexSnapshot> published_;
+
+	void MarkRemoved(size_t segment_index, int document_id);
+	// изменяемые копии списков удалённых в next_
+	std::set<int>& GetOwnedRemoved(size_t segment_index);
+	std::map<std::string, int, std::less<>>& GetOwnedRemovedDocumentFreqs();
+	// черновик, содержащий document_id; документ из сегмента переносится в черновик
+	SearchServer& TakeDocument(int document_id);
+	void MergeLastSegments();
+};
+
+template <typename DocumentPredicate, typename ExecutionPolicy>
+std::vector<Document> IndexSnapshot::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query,
+DocumentPredicate document_predicate) const {
+	if (segments_.size() == 1 && !segments_.front().removed) {
+		return segments_.front().server->FindTopDocuments(policy, raw_query, document_predicate);
+	}
+	const QueryStatistics statistics = CollectQueryStatistics(raw_query);
+	std::vector<std::vector<Document>> top_documents(segments_.size());
+	std::transform(policy, segments_.begin(), segments_.end(), top_documents.begin(),
+		[&](const Segment& segment) {
+			if (!segment.removed) {
+				return segment.server->FindTopDocuments(policy, raw_query, document_predicate, statistics);
+			}
+			const std::set<int>& removed = *segment.removed;
+			return segment.server->FindTopDocuments(policy, raw_query,
+				[&removed, &document_predicate](int document_id, DocumentStatus status, int rating) {
+					return removed.count(document_id) == 0 && document_predicate(document_id, status, rating);
+				},
+				statistics);
+		});
+	return MergeTopDocuments(top_documents);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> IndexSnapshot::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query,
+DocumentStatus status) const {
+	return FindTopDocuments(policy, raw_query, [status](int, DocumentStatus document_status, int) {
+		return document_status == status;
+	});
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> IndexSnapshot::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query) const {
+	return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> IndexSnapshot::FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const {
+	return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+}
+
+template <typename StringContainer>
+SnapshotSearchServer::SnapshotSearchServer(const StringContainer& stop_words)
+: empty_segment_(stop_words)
+, draft_(std::make_unique<SearchServer>(empty_segment_)) {
+	next_.segments_.push_back({std::make_shared<const SearchServer>(empty_segment_), nullptr});
+	next_.removed_document_freqs_ = std::make_shared<const std::map<std::string, int, std::less<>>>();
+	published_ = std::make_shared<const IndexSnapshot>(next_);
+	current_.store(published_.get());
+}
+
+template <typename... Args>
+std::vector<Document> SnapshotSearchServer::FindTopDocuments(const Args&... args) const {
+	const RcuDomain::ReadGuard guard(rcu_);
+	return current_.load()->FindTopDocuments(args...);
+}
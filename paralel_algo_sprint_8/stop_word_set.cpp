@@ -0,0 +1,42 @@
+#include "stop_word_set.h"
+
+using namespace std::string_literals;
+
+StopWordSet::StopWordSet(const std::set<std::string, std::less<>>& words) {
+	if (words.empty()) {
+		return;
+	}
+	const std::vector<std::string_view> word_views(words.begin(), words.end());
+	std::vector<uint64_t> hashes(word_views.size());
+	std::vector<uint32_t> bucket_starts(GetStopWordBucketCount(word_views.size()) + 1);
+	std::vector<uint32_t> members(word_views.size());
+	std::vector<uint32_t> slots(word_views.size());
+	pilots_.resize(GetStopWordBucketCount(word_views.size()));
+	while (!TryPlaceStopWords(word_views, seed_, hashes, bucket_starts, members, pilots_, slots)) {
+		if (++seed_ == MAX_STOP_WORD_SEED_COUNT) {
+			throw std::invalid_argument("Can't build stop word table"s);
+		}
+	}
+	slots_.reserve(slots.size());
+	for (const uint32_t word_index : slots) {
+		AddSlot(word_views[word_index]);
+	}
+}
+
+size_t StopWordSet::GetSize() const {
+	return slots_.size();
+}
+
+std::vector<std::string_view> StopWordSet::GetWords() const {
+	std::vector<std::string_view> words;
+	words.reserve(slots_.size());
+	for (const Slot slot : slots_) {
+		words.emplace_back(text_.data() + slot.offset, slot.size);
+	}
+	return words;
+}
+
+void StopWordSet::AddSlot(const std::string_view word) {
+	slots_.push_back({static_cast<uint32_t>(text_.size()), static_cast<uint32_t>(word.size())});
+	text_ += word;
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Минимальная совершенная хэш-функция над стоп-словами: слова разбиваются на корзины по старшим
+// битам хэша, для каждой корзины подбирается число-пилот, при котором её слова попадают
+// в свободные ячейки таблицы из ровно стольких ячеек, сколько слов. Проверка слова — один хэш,
+// пилот его корзины и одно сравнение с единственным словом, которое может лежать в ячейке
+
+// среднее число слов в корзине
+const size_t STOP_WORD_BUCKET_SIZE = 4;
+const uint32_t MAX_STOP_WORD_PILOT = UINT16_MAX;
+// столько затравок хэша перебирается, прежде чем построение считается невозможным
+const uint64_t MAX_STOP_WORD_SEED_COUNT = 64;
+const uint32_t EMPTY_STOP_WORD_SLOT = UINT32_MAX;
+
+// FNV-1a с затравкой и перемешиванием из splitmix64
+constexpr uint64_t HashStopWord(const std::string_view word, uint64_t seed) {
+	uint64_t hash = 0xcbf29ce484222325ULL ^ seed;
+	for (const char c : word) {
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 0x100000001b3ULL;
+	}
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ULL;
+	return hash ^ (hash >> 33);
+}
+
+constexpr size_t GetStopWordBucket(uint64_t hash, size_t bucket_count) {
+	return (hash >> 32) % bucket_count;
+}
+
+// умножение после xor с пилотом меняет, какие слова корзины сталкиваются, а сдвиг
+// переносит перемешанные старшие биты в младшие, от которых зависит остаток
+constexpr size_t GetStopWordSlot(uint64_t hash, uint32_t pilot, size_t slot_count) {
+	uint64_t mixed = (hash ^ (pilot * 0x9e3779b97f4a7c15ULL)) * 0xbf58476d1ce4e5b9ULL;
+	return (mixed ^ (mixed >> 31)) % slot_count;
+}
+
+constexpr size_t GetStopWordBucketCount(size_t word_count) {
+	return word_count / STOP_WORD_BUCKET_SIZE + 1;
+}
+
+// Раскладка слов по таблице при данной затравке. Общая для построения во время выполнения
+// (векторы) и во время компиляции (std::array). slots получает номер слова для каждой ячейки;
+// false, если для какой-то корзины пилот не нашёлся; повторы слов — std::invalid_argument
+template <typename Words, typename Hashes, typename Starts, typename Indices, typename Pilots>
+constexpr bool TryPlaceStopWords(const Words& words, uint64_t seed, Hashes& hashes, Starts& bucket_starts, Indices& members,
+Pilots& pilots, Indices& slots) {
+	const size_t count = words.size();
+	const size_t bucket_count = pilots.size();
+	// слова сортируются подсчётом по корзинам: после раскладки корзина b — [bucket_starts[b - 1], bucket_starts[b])
+	for (size_t bucket = 0; bucket <= bucket_count; ++bucket) {
+		bucket_starts[bucket] = 0;
+	}
+	for (size_t i = 0; i < count; ++i) {
+		hashes[i] = HashStopWord(words[i], seed);
+		++bucket_starts[GetStopWordBucket(hashes[i], bucket_count) + 1];
+	}
+	size_t max_bucket_size = 0;
+	for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+		max_bucket_size = bucket_starts[bucket + 1] > max_bucket_size ? bucket_starts[bucket + 1] : max_bucket_size;
+		bucket_starts[bucket + 1] += bucket_starts[bucket];
+	}
+	for (size_t i = 0; i < count; ++i) {
+		members[bucket_starts[GetStopWordBucket(hashes[i], bucket_count)]++] = i;
+		slots[i] = EMPTY_STOP_WORD_SLOT;
+	}
+
+	// большие корзины размещаются первыми, пока таблица пуста
+	for (size_t size = max_bucket_size; size > 0; --size) {
+		for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+			const size_t begin = bucket == 0 ? 0 : bucket_starts[bucket - 1];
+			const size_t end = bucket_starts[bucket];
+			if (end - begin != size) {
+				continue;
+			}
+			// одинаковые слова попадают в одну корзину и не разместятся ни при каком пилоте
+			for (size_t i = begin; i < end; ++i) {
+				for (size_t j = i + 1; j < end; ++j) {
+					if (words[members[i]] == words[members[j]]) {
+						throw std::invalid_argument("Stop words must be unique");
+					}
+				}
+			}
+			bool placed = false;
+			for (uint32_t pilot = 0; pilot <= MAX_STOP_WORD_PILOT && !placed; ++pilot) {
+				size_t next = begin;
+				while (next < end && slots[GetStopWordSlot(hashes[members[next]], pilot, count)] == EMPTY_STOP_WORD_SLOT) {
+					slots[GetStopWordSlot(hashes[members[next]], pilot, count)] = members[next];
+					++next;
+				}
+				placed = next == end;
+				if (placed) {
+					pilots[bucket] = pilot;
+				}
+				// откат частично размещённой корзины
+				for (size_t i = begin; i < next && !placed; ++i) {
+					slots[GetStopWordSlot(hashes[members[i]], pilot, count)] = EMPTY_STOP_WORD_SLOT;
+				}
+			}
+			if (!placed) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// Таблица, построенная при компиляции, если список стоп-слов известен заранее:
+//     constexpr std::array<std::string_view, 3> WORDS = {"and"sv, "in"sv, "on"sv};
+//     constexpr StaticStopWordSet stop_words(WORDS);
+template <size_t N>
+class StaticStopWordSet {
+public:
+	static constexpr size_t BUCKET_COUNT = GetStopWordBucketCount(N);
+
+	constexpr explicit StaticStopWordSet(const std::array<std::string_view, N>& words) {
+		std::array<uint64_t, N> hashes{};
+		std::array<uint32_t, BUCKET_COUNT + 1> bucket_starts{};
+		std::array<uint32_t, N> members{};
+		std::array<uint32_t, N> slots{};
+		while (!TryPlaceStopWords(words, seed_, hashes, bucket_starts, members, pilots_, slots)) {
+			if (++seed_ == MAX_STOP_WORD_SEED_COUNT) {
+				throw std::invalid_argument("Can't build stop word table");
+			}
+		}
+		for (size_t i = 0; i < N; ++i) {
+			words_[i] = words[slots[i]];
+		}
+	}
+
+	constexpr bool Contains(const std::string_view word) const {
+		if constexpr (N == 0) {
+			return false;
+		} else {
+			const uint64_t hash = HashStopWord(word, seed_);
+			return words_[GetStopWordSlot(hash, pilots_[GetStopWordBucket(hash, BUCKET_COUNT)], N)] == word;
+		}
+	}
+
+	constexpr uint64_t GetSeed() const {
+		return seed_;
+	}
+	constexpr const std::array<uint16_t, BUCKET_COUNT>& GetPilots() const {
+		return pilots_;
+	}
+	// слова в порядке ячеек таблицы
+	constexpr const std::array<std::string_view, N>& GetWords() const {
+		return words_;
+	}
+
+private:
+	uint64_t seed_ = 0;
+	std::array<uint16_t, BUCKET_COUNT> pilots_{};
+	std::array<std::string_view, N> words_{};
+};
+
+// Таблица, построенная во время выполнения; слова хранятся одной строкой
+class StopWordSet {
+public:
+	StopWordSet() = default;
+	explicit StopWordSet(const std::set<std::string, std::less<>>& words);
+	// готовая таблица без повторного подбора пилотов
+	template <size_t N>
+	explicit StopWordSet(const StaticStopWordSet<N>& table);
+
+	bool Contains(const std::string_view word) const {
+		if (slots_.empty()) {
+			return false;
+		}
+		const uint64_t hash = HashStopWord(word, seed_);
+		const Slot slot = slots_[GetStopWordSlot(hash, pilots_[GetStopWordBucket(hash, pilots_.size())], slots_.size())];
+		return std::string_view(text_.data() + slot.offset, slot.size) == word;
+	}
+
+	size_t GetSize() const;
+	std::vector<std::string_view> GetWords() const;
+
+private:
+	struct Slot {
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	uint64_t seed_ = 0;
+	std::vector<uint16_t> pilots_;
+	std::vector<Slot> slots_;
+	std::string text_;
+
+	void AddSlot(const std::string_view word);
+};
+
+template <size_t N>
+StopWordSet::StopWordSet(const StaticStopWordSet<N>& table)
+: seed_(table.GetSeed())
+, pilots_(table.GetPilots().begin(), table.GetPilots().end()) {
+	slots_.reserve(N);
+	for (const std::string_view word : table.GetWords()) {
+		AddSlot(word);
+	}
+}
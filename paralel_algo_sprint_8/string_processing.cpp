@@ -1,4 +1,43 @@
 #include "string_processing.h"
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std::string_literals;
+
+namespace {
+
+const size_t TOKENIZER_BLOCK_SIZE = 16;
+const size_t NO_WORD = std::string_view::npos;
+
+char FoldAsciiChar(char c) {
+	return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+bool IsControlChar(char c) {
+	return static_cast<unsigned char>(c) < ' ';
+}
+
+[[noreturn]] void ThrowInvalidWord(std::string_view text, size_t pos) {
+	const size_t space = text.rfind(' ', pos);
+	const size_t begin = space == std::string_view::npos ? 0 : space + 1;
+	const size_t end = std::min(text.find(' ', pos), text.size());
+	throw std::invalid_argument("Word "s + std::string(text.substr(begin, end - begin)) + " is invalid"s);
+}
+
+#if defined(__SSE2__)
+// 'A'..'Z' после сдвига на 0x80 - 'A' — самые малые знаковые байты [-128, -103]
+__m128i FoldAsciiBlock(__m128i bytes) {
+	const __m128i shifted = _mm_add_epi8(bytes, _mm_set1_epi8(static_cast<char>(0x80 - 'A')));
+	const __m128i is_upper = _mm_cmplt_epi8(shifted, _mm_set1_epi8(static_cast<char>(-128 + 26)));
+	return _mm_or_si128(bytes, _mm_and_si128(is_upper, _mm_set1_epi8('a' - 'A')));
+}
+#endif
+
+} // namespace
 
 std::vector<std::string> SplitIntoWords(std::string_view text) {
 	std::vector<std::string> words;
@@ -19,3 +58,67 @@ std::vector<std::string> SplitIntoWords(std::string_view text) {
 
 	return words;
 }
+
+void TokenizeWords(std::string_view text, char* folded, std::vector<std::string_view>& words) {
+	const char* const base = folded ? folded : text.data();
+	size_t word_begin = NO_WORD;
+	size_t pos = 0;
+#if defined(__SSE2__)
+	for (; pos + TOKENIZER_BLOCK_SIZE <= text.size(); pos += TOKENIZER_BLOCK_SIZE) {
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + pos));
+		const unsigned controls = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(bytes, _mm_set1_epi8(' ' - 1)), bytes));
+		if (controls != 0) {
+			ThrowInvalidWord(text, pos + __builtin_ctz(controls));
+		}
+		if (folded) {
+			bytes = FoldAsciiBlock(bytes);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(folded + pos), bytes);
+		}
+		const unsigned letters = ~_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(' '))) & 0xFFFF;
+		// бит i в boundaries — с байта i начинается слово или перед ним заканчивается
+		const unsigned previous = (letters << 1) | (word_begin != NO_WORD ? 1 : 0);
+		unsigned boundaries = (letters & ~previous) | (~letters & previous & 0xFFFF);
+		while (boundaries != 0) {
+			const size_t offset = pos + __builtin_ctz(boundaries);
+			if (word_begin == NO_WORD) {
+				word_begin = offset;
+			} else {
+				words.emplace_back(base + word_begin, offset - word_begin);
+				word_begin = NO_WORD;
+			}
+			boundaries &= boundaries - 1;
+		}
+	}
+#endif
+	for (; pos < text.size(); ++pos) {
+		const char c = text[pos];
+		if (IsControlChar(c)) {
+			ThrowInvalidWord(text, pos);
+		}
+		if (folded) {
+			folded[pos] = FoldAsciiChar(c);
+		}
+		if (c != ' ' && word_begin == NO_WORD) {
+			word_begin = pos;
+		} else if (c == ' ' && word_begin != NO_WORD) {
+			words.emplace_back(base + word_begin, pos - word_begin);
+			word_begin = NO_WORD;
+		}
+	}
+	if (word_begin != NO_WORD) {
+		words.emplace_back(base + word_begin, text.size() - word_begin);
+	}
+}
+
+void FoldAsciiCase(std::string_view text, char* folded) {
+	size_t pos = 0;
+#if defined(__SSE2__)
+	for (; pos + TOKENIZER_BLOCK_SIZE <= text.size(); pos += TOKENIZER_BLOCK_SIZE) {
+		const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + pos));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(folded + pos), FoldAsciiBlock(bytes));
+	}
+#endif
+	for (; pos < text.size(); ++pos) {
+		folded[pos] = FoldAsciiChar(text[pos]);
+	}
+}
@@ -3,10 +3,11 @@
 #include <vector>
 #include <string>
 #include <set>
+#include <string_view>
 
 template <typename StringContainer>
-std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
-    std::set<std::string> non_empty_strings;
+std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
+    std::set<std::string, std::less<>> non_empty_strings;
     for (const std::string& str : strings) {
 		if (!str.empty()) {
             non_empty_strings.insert(str);
@@ -15,3 +16,11 @@ std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings)
 	return non_empty_strings;
 }
 std::vector<std::string> SplitIntoWords(std::string_view text);
+// Один проход по text блоками SSE2: разбиение по пробелам, проверка на управляющие символы
+// и, если folded не nullptr, приведение ASCII-букв к нижнему регистру с записью в folded
+// (text.size() байт, folded может совпадать с text.data()). Байты >= 0x80, в том числе
+// продолжения UTF-8, не меняются. Слова дописываются в words и указывают в folded или в text;
+// слово с управляющим символом — std::invalid_argument
+void TokenizeWords(std::string_view text, char* folded, std::vector<std::string_view>& words);
+// приведение ASCII-букв к нижнему регистру без разбиения
+void FoldAsciiCase(std::string_view text, char* folded);
@@ -0,0 +1,1185 @@
+#include "bulk_ingest.h"
+#include "remove_duplicates.h"
+#include "request_queue.h"
+#include "result_writer.h"
+#include "ordinal_set.h"
+#include "paginator.h"
+#include "posting_kernels.h"
+#include "profiler.h"
+#include "query_arena.h"
+#include "rating_aggregator.h"
+#include "search_metrics.h"
+#include "search_server.h"
+#include "segmented_search_server.h"
+#include "sharded_search_server.h"
+#include "snapshot_search_server.h"
+#include "stop_word_set.h"
+#include "string_processing.h"
+#include "test_runner_p.h"
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// результаты сравниваются с выдачей обычного SearchServer с той же точностью, что и при ранжировании
+bool operator==(const Document& lhs, const Document& rhs) {
+	return lhs.id == rhs.id && lhs.rating == rhs.rating && abs(lhs.relevance - rhs.relevance) < RELEVANCE_EPSILON;
+}
+
+namespace {
+
+const vector<string> TEST_DOCUMENTS = {
+	"white cat and yellow hat"s,
+	"curly cat curly tail"s,
+	"nasty dog with big eyes"s,
+	"nasty pigeon john"s,
+	"catalog of curly dogs"s,
+	"big cattle and small cat"s,
+};
+
+SearchServer MakeTestServer() {
+	SearchServer search_server("and with of"s);
+	for (size_t i = 0; i < TEST_DOCUMENTS.size(); ++i) {
+		search_server.AddDocument(i, TEST_DOCUMENTS[i], DocumentStatus::ACTUAL, {static_cast<int>(i), 1});
+	}
+	return search_server;
+}
+
+void TestPrefixExpansion() {
+	const SearchServer search_server = MakeTestServer();
+	ASSERT_EQUAL(search_server.FindTermsByPrefix("cat"), vector<string_view>({"cat"sv, "catalog"sv, "cattle"sv}));
+	ASSERT_EQUAL(search_server.FindTermsByPrefix("cat", 2), vector<string_view>({"cat"sv, "catalog"sv}));
+	ASSERT(search_server.FindTermsByPrefix("zebra").empty());
+	// префикс раскрывается в обычные плюс-слова
+	ASSERT_EQUAL(search_server.FindTopDocuments("cat* -curly"), search_server.FindTopDocuments("cat catalog cattle -curly"));
+	ASSERT_EQUAL(search_server.FindTopDocuments(execution::par, "cat*"), search_server.FindTopDocuments("cat catalog cattle"));
+	// стоп-слово с * не отбрасывается: and* раскрывается в термины словаря, а их нет
+	ASSERT(search_server.FindTopDocuments("and*").empty());
+}
+
+void TestFuzzyExpansionRanking() {
+	SearchServer search_server("and"s);
+	// 19 терминов на расстоянии 1 от cat идут по алфавиту раньше самого cat
+	int document_id = 0;
+	for (char c = 'a'; c < 't'; ++c) {
+		search_server.AddDocument(document_id++, "ca"s + c, DocumentStatus::ACTUAL, {1});
+	}
+	search_server.AddDocument(document_id++, "cat"s, DocumentStatus::ACTUAL, {1});
+	// cut встречается в трёх документах — он ближе к началу среди расстояния 1
+	for (int i = 0; i < 3; ++i) {
+		search_server.AddDocument(document_id++, "cut"s, DocumentStatus::ACTUAL, {1});
+	}
+	const auto terms = search_server.FindTermsByEditDistance("cat", 1);
+	ASSERT_EQUAL(terms.size(), MAX_FUZZY_EXPANSION_COUNT);
+	ASSERT_EQUAL(terms[0], "cat"sv);
+	ASSERT_EQUAL(terms[1], "cut"sv);
+	ASSERT_EQUAL(terms[2], "caa"sv);
+	ASSERT(search_server.FindTermsByEditDistance("dog", 1).empty());
+
+	// нечёткий запрос совпадает с обычным по раскрытым терминам
+	SearchServer fuzzy_server = MakeTestServer();
+	fuzzy_server.SetFuzzyMatching(1);
+	const SearchServer exact_server = MakeTestServer();
+	ASSERT_EQUAL(fuzzy_server.FindTopDocuments("cst -curly"), exact_server.FindTopDocuments("cat -curly"));
+	ASSERT_EQUAL(fuzzy_server.FindTopDocuments("dogs"), exact_server.FindTopDocuments("dog dogs"));
+	// больше разных слов, чем вмещает кэш: вытеснение не меняет результаты
+	for (size_t i = 0; i <= MAX_FUZZY_CACHE_SIZE; ++i) {
+		fuzzy_server.FindTopDocuments("x"s + to_string(i));
+	}
+	ASSERT_EQUAL(fuzzy_server.FindTopDocuments("cst -curly"), exact_server.FindTopDocuments("cat -curly"));
+}
+
+void TestSnapshotSearchServer() {
+	SnapshotSearchServer snapshot_server("and with of"s);
+	SearchServer reference("and with of"s);
+	const vector<string> queries = {"cat"s, "curly -tail"s, "nasty big dog"s, "cattle hat eyes"s};
+	const auto check = [&]() {
+		ASSERT_EQUAL(snapshot_server.GetDocumentCount(), reference.GetDocumentCount());
+		for (const string& query : queries) {
+			ASSERT_EQUAL(snapshot_server.FindTopDocuments(query), reference.FindTopDocuments(query));
+			ASSERT_EQUAL(snapshot_server.FindTopDocuments(execution::par, query, DocumentStatus::BANNED),
+				reference.FindTopDocuments(query, DocumentStatus::BANNED));
+		}
+	};
+	// каждая публикация запечатывает отдельный сегмент
+	for (size_t i = 0; i < TEST_DOCUMENTS.size(); ++i) {
+		snapshot_server.AddDocument(i, TEST_DOCUMENTS[i], DocumentStatus::ACTUAL, {static_cast<int>(i), 1});
+		reference.AddDocument(i, TEST_DOCUMENTS[i], DocumentStatus::ACTUAL, {static_cast<int>(i), 1});
+		snapshot_server.Publish();
+		check();
+	}
+	ASSERT(snapshot_server.GetSnapshot()->GetSegmentCount() <= 4u);
+	ASSERT_THROWS(snapshot_server.AddDocument(1, "duplicate"s, DocumentStatus::ACTUAL, {}), invalid_argument);
+
+	const shared_ptr<const IndexSnapshot> old_snapshot = snapshot_server.GetSnapshot();
+	const vector<Document> old_result = old_snapshot->FindTopDocuments("cat"s);
+	snapshot_server.RemoveDocument(0);
+	snapshot_server.UpdateDocument(1, "curly dog"s, DocumentStatus::ACTUAL, {7});
+	snapshot_server.SetStatus(2, DocumentStatus::BANNED);
+	snapshot_server.AddRatings(3, {10});
+	snapshot_server.AddDocument(10, "small yellow cat"s, DocumentStatus::ACTUAL, {4});
+	// до публикации читатели видят прежнюю версию
+	check();
+	reference.RemoveDocument(0);
+	reference.UpdateDocument(1, "curly dog"s, DocumentStatus::ACTUAL, {7});
+	reference.SetStatus(2, DocumentStatus::BANNED);
+	reference.AddRatings(3, {10});
+	reference.AddDocument(10, "small yellow cat"s, DocumentStatus::ACTUAL, {4});
+	snapshot_server.Publish();
+	check();
+	ASSERT(!snapshot_server.GetSnapshot()->HasDocument(0));
+	ASSERT(get<1>(snapshot_server.GetSnapshot()->MatchDocument("nasty"s, 2)) == DocumentStatus::BANNED);
+	// удержанная версия не меняется
+	ASSERT_EQUAL(old_snapshot->FindTopDocuments("cat"s), old_result);
+}
+
+void TestSegmentedSearchServer() {
+	// по два документа в сегменте, слияние каждой пары сегментов
+	SegmentedSearchServer segmented_server("and with of"s, 2, 2);
+	SearchServer reference = MakeTestServer();
+	for (size_t i = 0; i < TEST_DOCUMENTS.size(); ++i) {
+		segmented_server.AddDocument(i, TEST_DOCUMENTS[i], DocumentStatus::ACTUAL, {static_cast<int>(i), 1});
+	}
+	const vector<string> queries = {"cat"s, "curly -tail"s, "nasty big dog"s, "cattle hat eyes"s};
+	const auto check = [&]() {
+		ASSERT_EQUAL(segmented_server.GetDocumentCount(), reference.GetDocumentCount());
+		for (const string& query : queries) {
+			ASSERT_EQUAL(segmented_server.FindTopDocuments(query), reference.FindTopDocuments(query));
+			ASSERT_EQUAL(segmented_server.FindTopDocuments(execution::par, query), reference.FindTopDocuments(query));
+		}
+	};
+	check();
+	// надгробия в запечатанных сегментах и удаление из изменяемого
+	for (const int document_id : {0, 3, 5}) {
+		segmented_server.RemoveDocument(document_id);
+		reference.RemoveDocument(document_id);
+		check();
+	}
+	segmented_server.RemoveDocument(100);
+	segmented_server.WaitForMerges();
+	check();
+	ASSERT(segmented_server.GetSegmentCount() <= 2u);
+	// удалённый из запечатанного сегмента id можно добавить снова, живой — нельзя
+	segmented_server.AddDocument(3, TEST_DOCUMENTS[3], DocumentStatus::ACTUAL, {3, 1});
+	reference.AddDocument(3, TEST_DOCUMENTS[3], DocumentStatus::ACTUAL, {3, 1});
+	check();
+	bool is_rejected = false;
+	try {
+		segmented_server.AddDocument(1, "curly"s, DocumentStatus::ACTUAL, {1});
+	} catch (const invalid_argument&) {
+		is_rejected = true;
+	}
+	ASSERT(is_rejected);
+}
+
+void TestGlobalExpansions() {
+	// раскрытий больше, чем помещается в ограничение, и частоты терминов различаются по частям
+	vector<string> texts;
+	for (int i = 0; i < 100; ++i) {
+		texts.push_back("term"s + to_string(100 + i));
+	}
+	for (int i = 0; i < 200; ++i) {
+		texts.push_back(string(1, static_cast<char>('a' + i * 7 % 26)) + "at"s);
+	}
+	SearchServer reference("and"s);
+	ShardedSearchServer sharded_server("and"s, 4);
+	SegmentedSearchServer segmented_server("and"s, 16);
+	SnapshotSearchServer snapshot_server("and"s);
+	for (size_t i = 0; i < texts.size(); ++i) {
+		const int id = static_cast<int>(i);
+		reference.AddDocument(id, texts[i], DocumentStatus::ACTUAL, {id});
+		sharded_server.AddDocument(id, texts[i], DocumentStatus::ACTUAL, {id});
+		segmented_server.AddDocument(id, texts[i], DocumentStatus::ACTUAL, {id});
+		snapshot_server.AddDocument(id, texts[i], DocumentStatus::ACTUAL, {id});
+		if (i % 50 == 0) {
+			snapshot_server.Publish();
+		}
+	}
+	snapshot_server.Publish();
+	ASSERT(snapshot_server.GetSnapshot()->GetSegmentCount() > 1u);
+	for (const string& query : {"term*"s, "term1* -term10*"s, "+(term15* | bat)"s}) {
+		ASSERT_EQUAL(sharded_server.FindTopDocuments(query), reference.FindTopDocuments(query));
+		ASSERT_EQUAL(segmented_server.FindTopDocuments(query), reference.FindTopDocuments(query));
+		ASSERT_EQUAL(snapshot_server.FindTopDocuments(query), reference.FindTopDocuments(query));
+	}
+
+	reference.SetFuzzyMatching(1);
+	sharded_server.SetFuzzyMatching(1);
+	snapshot_server.SetFuzzyMatching(1);
+	snapshot_server.Publish();
+	for (const string& query : {"cat"s, "xat -bat"s, "ct"s}) {
+		ASSERT_EQUAL(sharded_server.FindTopDocuments(query), reference.FindTopDocuments(query));
+		ASSERT_EQUAL(sharded_server.FindTopDocuments(execution::par, query), reference.FindTopDocuments(query));
+		ASSERT_EQUAL(snapshot_server.FindTopDocuments(query), reference.FindTopDocuments(query));
+	}
+
+	sharded_server.RemoveDocuments({0, 1, 100, 101});
+	reference.RemoveDocuments({0, 1, 100, 101});
+	ASSERT_EQUAL(sharded_server.GetDocumentCount(), reference.GetDocumentCount());
+	ASSERT_EQUAL(sharded_server.FindTopDocuments("cat term10*"s), reference.FindTopDocuments("cat term10*"s));
+
+	// в одном сегменте больше MAX_PREFIX_EXPANSION_COUNT терминов, первые по алфавиту только у удалённых документов
+	SearchServer removed_reference("and"s);
+	SegmentedSearchServer tombstoned_server("and"s, 128);
+	SnapshotSearchServer removed_snapshot_server("and"s);
+	for (size_t i = 0; i < texts.size(); ++i) {
+		const int id = static_cast<int>(i);
+		removed_reference.AddDocument(id, texts[i], DocumentStatus::ACTUAL, {id});
+		tombstoned_server.AddDocument(id, texts[i], DocumentStatus::ACTUAL, {id});
+		removed_snapshot_server.AddDocument(id, texts[i], DocumentStatus::ACTUAL, {id});
+	}
+	removed_snapshot_server.Publish();
+	for (int id = 0; id < 20; ++id) {
+		removed_reference.RemoveDocument(id);
+		tombstoned_server.RemoveDocument(id);
+		removed_snapshot_server.RemoveDocument(id);
+	}
+	removed_snapshot_server.Publish();
+	ASSERT_EQUAL(removed_snapshot_server.GetSnapshot()->GetSegmentCount(), 1u);
+	for (const string& query : {"term*"s, "term1* -term15*"s, "+(term1* | bat)"s}) {
+		ASSERT_EQUAL(tombstoned_server.FindTopDocuments(query), removed_reference.FindTopDocuments(query));
+		ASSERT_EQUAL(removed_snapshot_server.FindTopDocuments(query), removed_reference.FindTopDocuments(query));
+	}
+}
+
+void TestNumaShardPlacement() {
+	ASSERT(GetNumaNodeCount() >= 1u);
+	for (size_t node = 0; node < GetNumaNodeCount(); ++node) {
+		ASSERT(!GetNumaNodeCpus()[node].empty());
+		ASSERT(GetNumaNodeId(node) >= 0);
+	}
+	ShardedSearchServer numa_server("and with of"s, 3, ShardPlacement::NUMA_NODES);
+	SearchServer reference = MakeTestServer();
+	vector<DocumentInput> documents;
+	for (size_t i = 0; i < TEST_DOCUMENTS.size(); ++i) {
+		documents.push_back({static_cast<int>(i), TEST_DOCUMENTS[i], DocumentStatus::ACTUAL, {static_cast<int>(i), 1}});
+	}
+	numa_server.AddDocuments(documents);
+	for (size_t i = 0; i < numa_server.GetShardCount(); ++i) {
+		ASSERT(numa_server.GetShardNode(i) < GetNumaNodeCount());
+	}
+	for (const string& query : {"cat"s, "curly -tail"s, "nasty big dog"s}) {
+		ASSERT_EQUAL(numa_server.FindTopDocuments(query), reference.FindTopDocuments(query));
+		ASSERT_EQUAL(numa_server.FindTopDocuments(execution::par, query), reference.FindTopDocuments(query));
+	}
+	numa_server.RemoveDocuments({1, 4});
+	reference.RemoveDocuments({1, 4});
+	ASSERT_EQUAL(numa_server.GetDocumentCount(), reference.GetDocumentCount());
+	ASSERT_EQUAL(numa_server.FindTopDocuments("curly cat"s), reference.FindTopDocuments("curly cat"s));
+}
+
+void TestRemoveDuplicates() {
+	SearchServer search_server("and with"s);
+	search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+	search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+	// тот же набор слов: другой порядок, повторы и стоп-слова
+	search_server.AddDocument(3, "funny pet with curly hair curly"s, DocumentStatus::ACTUAL, {1, 2});
+	search_server.AddDocument(4, "hair curly pet funny and"s, DocumentStatus::BANNED, {1, 2});
+	search_server.AddDocument(5, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+	// почти тот же набор: 9 общих слов из 10
+	search_server.AddDocument(6, "a b c d e f g h i"s, DocumentStatus::ACTUAL, {1});
+	search_server.AddDocument(7, "a b c d e f g h i j"s, DocumentStatus::ACTUAL, {1});
+	search_server.AddDocument(8, "k l m n o p q r s"s, DocumentStatus::ACTUAL, {1});
+
+	SearchServer exact_server = search_server;
+	RemoveDuplicates(exact_server);
+	ASSERT_EQUAL(vector<int>(exact_server.begin(), exact_server.end()), vector<int>({1, 2, 5, 6, 7, 8}));
+	SearchServer reference = search_server;
+	reference.RemoveDocuments({3, 4});
+	ASSERT_EQUAL(exact_server.FindTopDocuments("curly rat"s), reference.FindTopDocuments("curly rat"s));
+
+	RemoveNearDuplicates(search_server, 0.8);
+	ASSERT_EQUAL(vector<int>(search_server.begin(), search_server.end()), vector<int>({1, 2, 5, 6, 8}));
+
+	// порог вне (0, 1] отклоняется до изменения сервера
+	for (double threshold : {0.0, -0.5, 1.5, numeric_limits<double>::quiet_NaN()}) {
+		ASSERT_THROWS(RemoveNearDuplicates(search_server, threshold), invalid_argument);
+	}
+	ASSERT_EQUAL(search_server.GetDocumentCount(), 5);
+	RemoveNearDuplicates(search_server, 1.0);
+	ASSERT_EQUAL(search_server.GetDocumentCount(), 5);
+}
+
+void TestRemoveDocumentsBatch() {
+	SearchServer batch_server = MakeTestServer();
+	SearchServer par_server = MakeTestServer();
+	SearchServer reference = MakeTestServer();
+	// повторы и отсутствующие id пропускаются
+	batch_server.RemoveDocuments({4, 1, 4, 100});
+	par_server.RemoveDocuments(execution::par, {1, 4});
+	reference.RemoveDocument(1);
+	reference.RemoveDocument(4);
+	ASSERT_EQUAL(batch_server.GetDocumentCount(), 4);
+	ASSERT_EQUAL(par_server.GetDocumentCount(), 4);
+	ASSERT(!batch_server.HasDocument(1) && !batch_server.HasDocument(4));
+	for (const string& query : {"curly"s, "cat -nasty"s, "dogs big"s, "cat*"s}) {
+		ASSERT_EQUAL(batch_server.FindTopDocuments(query), reference.FindTopDocuments(query));
+		ASSERT_EQUAL(par_server.FindTopDocuments(query), reference.FindTopDocuments(query));
+	}
+	// слова удалённых документов больше не раскрываются
+	ASSERT_EQUAL(batch_server.FindTermsByPrefix("cat"), vector<string_view>({"cat"sv, "cattle"sv}));
+	ASSERT(batch_server.GetWordFrequencies(1).empty());
+}
+
+void TestWordFrequenciesIterator() {
+	const SearchServer search_server = MakeTestServer();
+	const SearchServer::WordFrequencies word_freqs = search_server.GetWordFrequencies(1);
+	// прямой индекс отсортирован по term_id, а не по слову
+	const map<string_view, double> expected = {{"curly"sv, 0.5}, {"cat"sv, 0.25}, {"tail"sv, 0.25}};
+	ASSERT_EQUAL((map<string_view, double>(word_freqs.begin(), word_freqs.end())), expected);
+	ASSERT_EQUAL(word_freqs.size(), 3u);
+
+	// прокси: элемент по значению, поэтому категория input, а произвольный доступ — дополнительно
+	using WordIterator = SearchServer::WordFrequencies::Iterator;
+	static_assert(is_same_v<iterator_traits<WordIterator>::iterator_category, input_iterator_tag>);
+	static_assert(!is_reference_v<iterator_traits<WordIterator>::reference>);
+
+	auto it = word_freqs.begin();
+	const auto end = word_freqs.end();
+	ASSERT_EQUAL(end - it, 3);
+	ASSERT(it < end && end > it && it <= it && end >= it);
+	ASSERT((it + 2)[0] == it[2] && (2 + it) == it + 2);
+	it += 3;
+	ASSERT(it == end);
+	it -= 1;
+	ASSERT(*it == *(end - 1) && *it-- == *(end - 1) && *it == end[-2]);
+	ASSERT(*--it == word_freqs.begin()[0]);
+	ASSERT(it++ == word_freqs.begin() && it == word_freqs.begin() + 1);
+
+	// страницы берутся по номеру, без обхода предыдущих
+	auto pages = PaginateLazy(word_freqs, 2);
+	static_assert(decltype(pages)::IS_RANDOM_ACCESS);
+	ASSERT_EQUAL(pages.size(), 2u);
+	ASSERT_EQUAL(pages[1].size(), 1u);
+	ASSERT(*pages[1].begin() == *(end - 1));
+}
+
+void TestRequestQueue() {
+	const SearchServer search_server = MakeTestServer();
+	RequestQueue request_queue(search_server, 3);
+	ASSERT_EQUAL(request_queue.AddFindRequest("cat"s), search_server.FindTopDocuments("cat"s));
+	request_queue.AddFindRequest("zebra"s);
+	request_queue.AddFindRequest("curly"s, DocumentStatus::BANNED);
+	ASSERT_EQUAL(request_queue.GetRequestCount(), 3);
+	ASSERT_EQUAL(request_queue.GetNoResultRequests(), 2);
+	// окно сдвигается: первый запрос выпадает
+	request_queue.AddFindRequest("dog"s, [](int document_id, DocumentStatus, int) {
+		return document_id == 2;
+	});
+	ASSERT_EQUAL(request_queue.GetRequestCount(), 3);
+	ASSERT_EQUAL(request_queue.GetNoResultRequests(), 2);
+	request_queue.AddFindRequest("nasty"s);
+	request_queue.AddFindRequest("pigeon"s);
+	ASSERT_EQUAL(request_queue.GetNoResultRequests(), 0);
+	ASSERT(request_queue.GetLatencyPercentile(100) >= request_queue.GetLatencyPercentile(50));
+
+	// запись из нескольких потоков без блокировок
+	RequestQueue shared_queue(search_server, 2000);
+	vector<thread> threads;
+	for (int i = 0; i < 4; ++i) {
+		threads.emplace_back([&shared_queue] {
+			for (int j = 0; j < 500; ++j) {
+				shared_queue.AddFindRequest(j % 2 == 0 ? "zebra"s : "cat"s);
+			}
+		});
+	}
+	for (thread& worker : threads) {
+		worker.join();
+	}
+	ASSERT_EQUAL(shared_queue.GetRequestCount(), 2000);
+	ASSERT_EQUAL(shared_queue.GetNoResultRequests(), 1000);
+
+	RequestQueue time_queue(search_server, chrono::hours(1));
+	time_queue.AddFindRequest("cat"s);
+	time_queue.AddFindRequest("zebra"s);
+	ASSERT_EQUAL(time_queue.GetRequestCount(), 2);
+	ASSERT_EQUAL(time_queue.GetNoResultRequests(), 1);
+
+	// корзины короче миллисекунды не поддерживаются
+	bool is_rejected = false;
+	try {
+		RequestQueue tiny_queue(search_server, chrono::milliseconds(59));
+	} catch (const invalid_argument&) {
+		is_rejected = true;
+	}
+	ASSERT(is_rejected);
+	RequestQueue min_queue(search_server, chrono::milliseconds(60));
+	min_queue.AddFindRequest("zebra"s);
+	ASSERT_EQUAL(min_queue.GetRequestCount(), 1);
+}
+
+void TestRequestQueueTimeWindowContention() {
+	const SearchServer search_server = MakeTestServer();
+	// корзины по 20 мс: за 600 мс записи пересекают около 30 границ интервалов, но все остаются в окне
+	RequestQueue time_queue(search_server, chrono::milliseconds(1200));
+	const auto deadline = RequestQueue::Clock::now() + chrono::milliseconds(600);
+	atomic<int> request_count = 0;
+	atomic<int> empty_count = 0;
+	vector<thread> threads;
+	for (int i = 0; i < 8; ++i) {
+		threads.emplace_back([&] {
+			for (int j = 0; RequestQueue::Clock::now() < deadline; ++j) {
+				const bool is_empty = j % 2 == 0;
+				time_queue.AddFindRequest(is_empty ? "zebra"s : "cat"s);
+				request_count.fetch_add(1);
+				empty_count.fetch_add(is_empty ? 1 : 0);
+			}
+		});
+	}
+	for (thread& worker : threads) {
+		worker.join();
+	}
+	// смена интервала в корзине не теряет записи других потоков
+	ASSERT_EQUAL(time_queue.GetRequestCount(), request_count.load());
+	ASSERT_EQUAL(time_queue.GetNoResultRequests(), empty_count.load());
+}
+
+void TestRequestQueueSmallWindowContention() {
+	const SearchServer search_server = MakeTestServer();
+	// окно меньше числа писателей: ячейки постоянно вытесняют друг у друга
+	RequestQueue request_queue(search_server, 1);
+	const int thread_count = 4;
+	atomic<bool> done = false;
+	vector<thread> threads;
+	for (int i = 0; i < thread_count; ++i) {
+		threads.emplace_back([&request_queue] {
+			for (int j = 0; j < 20000; ++j) {
+				request_queue.AddFindRequest(j % 2 == 0 ? "zebra"s : "cat"s);
+			}
+		});
+	}
+	atomic<bool> counters_in_range = true;
+	thread reader([&] {
+		while (!done.load()) {
+			// в окне одна запись, плюс вытесненные и ещё не записанные у каждого писателя; в минус счётчики не уходят
+			const int request_count = request_queue.GetRequestCount();
+			const int empty_count = request_queue.GetNoResultRequests();
+			if (request_count < 0 || request_count > thread_count + 1 || empty_count < 0 || empty_count > thread_count + 1) {
+				counters_in_range = false;
+			}
+		}
+	});
+	for (thread& worker : threads) {
+		worker.join();
+	}
+	done = true;
+	reader.join();
+	ASSERT(counters_in_range.load());
+	ASSERT_EQUAL(request_queue.GetRequestCount(), 1);
+	ASSERT(request_queue.GetNoResultRequests() <= 1);
+	// единственная запись в окне: все перцентили указывают на её интервал
+	ASSERT(request_queue.GetLatencyPercentile(0) == request_queue.GetLatencyPercentile(100));
+}
+
+void TestSearchMetrics() {
+	ASSERT_EQUAL(GetLatencyBucket(chrono::nanoseconds(0)), 0u);
+	for (const auto latency : {chrono::nanoseconds(1), chrono::nanoseconds(1000), chrono::nanoseconds(123'456'789)}) {
+		const size_t bucket = GetLatencyBucket(latency);
+		ASSERT(GetLatencyBucketUpperBound(bucket) >= latency);
+		ASSERT(bucket == 0 || GetLatencyBucketUpperBound(bucket - 1) < latency);
+	}
+
+	const SearchServer search_server = MakeTestServer();
+	const SearchMetricsSnapshot before = CollectSearchMetrics();
+	ASSERT_EQUAL(search_server.FindTopDocuments("curly cat"s).size(), 4u);
+	search_server.FindTopDocuments(execution::par, "nasty -pigeon"s);
+	// метрики завершившегося потока остаются в снимке
+	thread([&search_server] {
+		search_server.FindTopDocuments("pigeon"s);
+	}).join();
+	const SearchMetricsSnapshot after = CollectSearchMetrics();
+	for (const SearchPhase phase : {SearchPhase::PARSE, SearchPhase::POSTINGS_FETCH, SearchPhase::SCORING, SearchPhase::FILTERING,
+		SearchPhase::TOP_K, SearchPhase::TOTAL}) {
+		ASSERT_EQUAL(after.GetCount(phase) - before.GetCount(phase), 3u);
+	}
+	// «curly» и «cat» встречаются в 2 и 3 документах, «nasty» — в 2, «pigeon» — в 1;
+	// документ с «nasty» и «pigeon» просмотрен, но не оценён
+	ASSERT_EQUAL(after.postings_scanned - before.postings_scanned, 8u);
+	ASSERT_EQUAL(after.documents_scored - before.documents_scored, 7u);
+	// при обязательном слове просматриваются только кандидаты: из трёх документов с «cat» «curly» есть в одном
+	const SearchMetricsSnapshot before_required = CollectSearchMetrics();
+	search_server.FindTopDocuments("cat +curly"s);
+	const SearchMetricsSnapshot after_required = CollectSearchMetrics();
+	ASSERT_EQUAL(after_required.postings_scanned - before_required.postings_scanned, 3u);
+	ASSERT(after.GetPercentile(SearchPhase::TOTAL, 99) >= after.GetPercentile(SearchPhase::TOTAL, 50));
+
+	ostringstream out;
+	PrintSearchMetrics(out, after);
+	ASSERT(out.str().find("TYPE"s) != string::npos);
+}
+
+void RunProfiledSite() {
+	PROFILE_SCOPE("TestProfiledSite");
+	this_thread::sleep_for(chrono::microseconds(10));
+}
+
+void TestProfiler() {
+	thread worker([] {
+		RunProfiledSite();
+		RunProfiledSite();
+	});
+	RunProfiledSite();
+	worker.join();
+
+	// сводка складывает вызовы всех потоков
+	ostringstream flat_profile;
+	PrintFlatProfile(flat_profile);
+	const string flat_text = flat_profile.str();
+	const size_t row = flat_text.find("TestProfiledSite"s);
+	ASSERT(row != string::npos);
+	istringstream row_input(flat_text.substr(row, flat_text.find('\n', row) - row));
+	string name;
+	uint64_t calls = 0, total_ns = 0, avg_ns = 0, min_ns = 0;
+	row_input >> name >> calls >> total_ns >> avg_ns >> min_ns;
+	ASSERT_EQUAL(calls, 3u);
+	ASSERT(min_ns >= 10'000u && total_ns >= 3 * min_ns);
+
+	// события завершившегося потока остаются в трассировке
+	SetProfilerTracing(true);
+	RunProfiledSite();
+	thread(RunProfiledSite).join();
+	SetProfilerTracing(false);
+	ostringstream trace;
+	PrintChromeTrace(trace);
+	const string trace_text = trace.str();
+	const string event_prefix = "{\"name\":\"TestProfiledSite\",\"ph\":\"X\""s;
+	size_t event_count = 0;
+	for (size_t pos = trace_text.find(event_prefix); pos != string::npos; pos = trace_text.find(event_prefix, pos + 1)) {
+		++event_count;
+	}
+	ASSERT_EQUAL(event_count, 2u);
+}
+
+void TestQueryGrammar() {
+	SearchServer search_server("and"s);
+	search_server.AddDocument(0, "white cat and yellow hat"s, DocumentStatus::ACTUAL, {1});
+	search_server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, {2});
+	search_server.AddDocument(2, "nasty dog with big eyes"s, DocumentStatus::ACTUAL, {3});
+	search_server.AddDocument(3, "c++ a|b (note) x^2 +1 -5 star*"s, DocumentStatus::ACTUAL, {4});
+	const auto ids = [&search_server](const string& query) {
+		vector<int> result;
+		for (const Document& document : search_server.FindTopDocuments(query)) {
+			result.push_back(document.id);
+		}
+		sort(result.begin(), result.end());
+		return result;
+	};
+
+	// обязательные слова и группы пересекаются, минус-слова исключают
+	ASSERT_EQUAL(ids("+cat curly"s), vector<int>({0, 1}));
+	ASSERT_EQUAL(ids("+(tail | dog | hat) -curly"s), vector<int>({0, 2}));
+	ASSERT_EQUAL(ids("+(tail|eyes) +(curly|big)"s), vector<int>({1, 2}));
+	ASSERT_EQUAL(ids("+zebra cat"s), vector<int>());
+	// множитель меняет порядок, но не состав
+	ASSERT_EQUAL(search_server.FindTopDocuments("cat dog^10"s)[0].id, 2);
+	ASSERT_EQUAL(search_server.FindTopDocuments("(cat | hat)^2"s)[0].relevance, 2 * search_server.FindTopDocuments("cat hat"s)[0].relevance);
+
+	// специальные символы внутри слова экранируются
+	ASSERT_EQUAL(ids("c++"s), vector<int>({3}));
+	ASSERT_EQUAL(ids("a\\|b"s), vector<int>({3}));
+	ASSERT_EQUAL(ids("\\(note\\)"s), vector<int>({3}));
+	ASSERT_EQUAL(ids("x\\^2 \\+1"s), vector<int>({3}));
+	ASSERT_EQUAL(ids("+\\-5"s), vector<int>({3}));
+	ASSERT_EQUAL(ids("star\\*"s), vector<int>({3}));
+	ASSERT_EQUAL(ids("+(cat | \\-5) -\\(note\\)"s), vector<int>({0, 1}));
+	ASSERT_EQUAL(get<0>(search_server.MatchDocument("a\\|b zebra"s, 3)), vector<string_view>({"a|b"sv}));
+	for (const string& query : {"a|b"s, "no(te"s, "x^"s, "x^2^3"s, "cat\\"s, "--cat"s, "+"s, "(cat"s, "()"s, "cat^0"s, "(cat)x"s}) {
+		ASSERT_THROWS(search_server.FindTopDocuments(query), invalid_argument);
+	}
+}
+
+void TestOrdinalSet() {
+	const uint32_t universe_size = 10'000;
+	// мало элементов — массив, много — битовая карта; ответы одинаковые
+	for (const size_t step : {1000u, 7u}) {
+		vector<uint32_t> ordinals;
+		for (uint32_t ordinal = 3; ordinal < universe_size; ordinal += step) {
+			ordinals.push_back(ordinal);
+		}
+		OrdinalSet ordinal_set(universe_size, ordinals.size());
+		// порядок вставки и повторы не важны
+		for (auto it = ordinals.rbegin(); it != ordinals.rend(); ++it) {
+			ordinal_set.Insert(*it);
+			ordinal_set.Insert(*it);
+		}
+		ordinal_set.Seal();
+		ASSERT_EQUAL(ordinal_set.IsBitmap(), step == 7u);
+		ASSERT(!ordinal_set.IsEmpty());
+		for (uint32_t ordinal = 0; ordinal < universe_size; ++ordinal) {
+			ASSERT_EQUAL(ordinal_set.Contains(ordinal), binary_search(ordinals.begin(), ordinals.end(), ordinal));
+		}
+	}
+	OrdinalSet empty_set(universe_size, 0);
+	empty_set.Seal();
+	ASSERT(empty_set.IsEmpty() && !empty_set.Contains(0));
+
+	// пополняемая карта растёт под новые номера
+	OrdinalBitmap bitmap;
+	ASSERT(!bitmap.Contains(0) && !bitmap.Contains(1000));
+	bitmap.Insert(130);
+	bitmap.Insert(2);
+	ASSERT(bitmap.Contains(2) && bitmap.Contains(130));
+	ASSERT(!bitmap.Contains(3) && !bitmap.Contains(129) && !bitmap.Contains(100000));
+
+	// минус-слова исключают документы так же, как в SearchServer без них
+	SearchServer search_server = MakeTestServer();
+	ASSERT_EQUAL(search_server.FindTopDocuments("cat curly -tail -hat"s), search_server.FindTopDocuments("cat curly", [](int document_id, DocumentStatus, int) {
+		return document_id != 0 && document_id != 1;
+	}));
+	search_server.RemoveDocument(0);
+	search_server.AddDocument(10, "white cat"s, DocumentStatus::ACTUAL, {1});
+	ASSERT_EQUAL(search_server.FindTopDocuments(execution::par, "cat -white"s), search_server.FindTopDocuments("cat", [](int document_id, DocumentStatus, int) {
+		return document_id != 10;
+	}));
+	// номера документов переносятся при копировании и назначаются при слиянии
+	SearchServer copied_server = search_server;
+	copied_server.MergeDocument(MakeTestServer(), 0);
+	ASSERT_EQUAL(copied_server.FindTopDocuments("cat -white"s), copied_server.FindTopDocuments("cat", [](int document_id, DocumentStatus, int) {
+		return document_id != 0 && document_id != 10;
+	}));
+
+	// номера хранятся в списках слов, а не в таблице по id: память не зависит от величины id
+	SearchServer sparse_server("and with of"s);
+	sparse_server.AddDocument(2'000'000'000, "white cat"s, DocumentStatus::ACTUAL, {1});
+	sparse_server.AddDocument(3, "black cat"s, DocumentStatus::ACTUAL, {2});
+	sparse_server.AddDocument(numeric_limits<int>::max(), "white dog"s, DocumentStatus::ACTUAL, {3});
+	const vector<SearchServer> sparse_copies(4, sparse_server);
+	for (const SearchServer& server : sparse_copies) {
+		const auto documents = server.FindTopDocuments("cat dog -black"s);
+		ASSERT_EQUAL(documents.size(), 2u);
+		ASSERT(documents[0].id != 3 && documents[1].id != 3);
+	}
+	sparse_server.UpdateDocument(3, "white cat"s, DocumentStatus::ACTUAL, {2});
+	sparse_server.RemoveDocuments({2'000'000'000, numeric_limits<int>::max()});
+	ASSERT_EQUAL(sparse_server.FindTopDocuments("cat -black"s).size(), 1u);
+	ASSERT(sparse_server.FindTopDocuments("cat -white"s).empty());
+}
+
+void TestPostingKernels() {
+	mt19937 generator(42);
+	const auto generate = [&generator](size_t size, uint32_t universe) {
+		vector<uint32_t> ids(size);
+		for (uint32_t& id : ids) {
+			id = uniform_int_distribution<uint32_t>(0, universe - 1)(generator);
+		}
+		sort(ids.begin(), ids.end());
+		ids.erase(unique(ids.begin(), ids.end()), ids.end());
+		return ids;
+	};
+	// длины не кратны блокам, в том числе пустые списки и сильно разные по длине
+	for (const auto& [lhs_size, rhs_size] : {pair<size_t, size_t>{0, 10}, {1, 1}, {37, 45}, {1000, 1003}, {5000, 17}, {17, 5000}}) {
+		const vector<uint32_t> lhs = generate(lhs_size, 4 * max<uint32_t>(lhs_size, rhs_size));
+		const vector<uint32_t> rhs = generate(rhs_size, 4 * max<uint32_t>(lhs_size, rhs_size));
+		vector<uint32_t> expected;
+		set_intersection(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), back_inserter(expected));
+		for (const PostingKernel kernel : {PostingKernel::SCALAR, PostingKernel::SSE, PostingKernel::AVX2}) {
+			if (!IsPostingKernelSupported(kernel)) {
+				continue;
+			}
+			vector<uint32_t> out(min(lhs.size(), rhs.size()) + 8);
+			out.resize(IntersectSorted(kernel, lhs.data(), lhs.size(), rhs.data(), rhs.size(), out.data()));
+			ASSERT_EQUAL(out, expected);
+		}
+		const auto& [small, large] = lhs.size() < rhs.size() ? tie(lhs, rhs) : tie(rhs, lhs);
+		vector<uint32_t> galloping(small.size());
+		galloping.resize(IntersectGalloping(small.data(), small.size(), large.data(), large.size(), galloping.data()));
+		ASSERT_EQUAL(galloping, expected);
+		ASSERT_EQUAL(IntersectSorted(lhs, rhs), expected);
+		// позиции общих элементов в rhs, по ним берутся частоты списка слова
+		vector<uint32_t> positions(min(lhs.size(), rhs.size()) + 8);
+		positions.resize(IntersectPositions(lhs.data(), lhs.size(), rhs.data(), rhs.size(), positions.data()));
+		ASSERT_EQUAL(positions.size(), expected.size());
+		for (size_t i = 0; i < positions.size(); ++i) {
+			ASSERT_EQUAL(rhs[positions[i]], expected[i]);
+		}
+
+		vector<uint32_t> united;
+		set_union(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), back_inserter(united));
+		ASSERT_EQUAL(UniteSorted(lhs, rhs), united);
+		vector<uint32_t> difference;
+		set_difference(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), back_inserter(difference));
+		ASSERT_EQUAL(SubtractSorted(lhs, rhs), difference);
+	}
+	// галоп при сильно разных длинах: общие элементы на краях и внутри, отсутствующие между ними
+	vector<uint32_t> evens;
+	for (uint32_t id = 0; id < 10'000; id += 2) {
+		evens.push_back(id);
+	}
+	const vector<uint32_t> sparse = {0, 3, 500, 501, 9998, 20'001};
+	const auto check_skewed = [](const vector<uint32_t>& lhs, const vector<uint32_t>& rhs) {
+		vector<uint32_t> united;
+		set_union(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), back_inserter(united));
+		ASSERT_EQUAL(UniteSorted(lhs, rhs), united);
+		vector<uint32_t> difference;
+		set_difference(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), back_inserter(difference));
+		ASSERT_EQUAL(SubtractSorted(lhs, rhs), difference);
+	};
+	check_skewed(evens, sparse);
+	check_skewed(sparse, evens);
+	ASSERT(IsPostingKernelSupported(PostingKernel::SCALAR) && IsPostingKernelSupported(GetPostingKernel()));
+
+	// обязательные слова: и пересечение, и проба редкой группы против частой
+	SearchServer search_server(""s);
+	vector<set<string>> document_words;
+	for (int document_id = 0; document_id < 500; ++document_id) {
+		string document;
+		set<string> words;
+		for (int i = 0; i < 6; ++i) {
+			const string word = "w"s + to_string(geometric_distribution<int>(0.3)(generator) % 12);
+			document += word + " "s;
+			words.insert(word);
+		}
+		search_server.AddDocument(document_id, document, DocumentStatus::ACTUAL, {document_id % 7});
+		document_words.push_back(move(words));
+	}
+	const auto contains_all = [&document_words](vector<string> words) {
+		return [&document_words, words](int document_id, DocumentStatus, int) {
+			return all_of(words.begin(), words.end(), [&](const string& word) {
+				return document_words[document_id].count(word) > 0;
+			});
+		};
+	};
+	ASSERT_EQUAL(search_server.FindTopDocuments("+w0 +w1 w2"s), search_server.FindTopDocuments("w0 w1 w2"s, contains_all({"w0"s, "w1"s})));
+	ASSERT_EQUAL(search_server.FindTopDocuments("+w0 +w9 w3"s), search_server.FindTopDocuments("w0 w9 w3"s, contains_all({"w0"s, "w9"s})));
+	ASSERT_EQUAL(search_server.FindTopDocuments(execution::par, "+w1 +w2 +w3"s),
+		search_server.FindTopDocuments("w1 w2 w3"s, contains_all({"w1"s, "w2"s, "w3"s})));
+
+	// отсортированные списки id слов правятся при добавлении не по порядку, удалении и обновлении
+	SearchServer shuffled_server(""s);
+	for (int document_id = 499; document_id >= 0; document_id -= 2) {
+		shuffled_server.AddDocument(document_id, *document_words[document_id].begin() + " w11"s, DocumentStatus::ACTUAL, {1});
+	}
+	shuffled_server.RemoveDocuments({499, 1, 251});
+	shuffled_server.UpdateDocument(3, "w0 w1"s, DocumentStatus::ACTUAL, {1});
+	const auto shuffled_top = shuffled_server.FindTopDocuments("+w0 +w1"s);
+	ASSERT_EQUAL(shuffled_top.size(), 1u);
+	ASSERT_EQUAL(shuffled_top[0].id, 3);
+	ASSERT(get<0>(shuffled_server.MatchDocument("+w11 w0"s, 3)).empty());
+	ASSERT_EQUAL(get<0>(shuffled_server.MatchDocument(execution::par, "+w1 w0"s, 3)).size(), 2u);
+	int w11_count = 0;
+	for (const int document_id : shuffled_server) {
+		w11_count += document_id != 3 && get<0>(shuffled_server.MatchDocument("+w11"s, document_id)).size() == 1;
+	}
+	ASSERT_EQUAL(w11_count, 246);
+}
+
+void TestBulkIngest() {
+	// больше INGEST_BLOCK_SIZE, чтобы строки переходили через границы блоков
+	string input;
+	SearchServer expected("and with of"s);
+	for (int document_id = 0; input.size() < 3 * INGEST_BLOCK_SIZE / 2; ++document_id) {
+		const string& text = TEST_DOCUMENTS[document_id % TEST_DOCUMENTS.size()];
+		const string document = text + " w"s + to_string(document_id % 97);
+		if (document_id % 3 == 0) {
+			// строка без табуляции: id — номер строки
+			input += document + "\n"s;
+			expected.AddDocument(document_id, document, DocumentStatus::ACTUAL, {});
+		} else {
+			input += to_string(document_id) + "\tBANNED\t"s + to_string(document_id % 5) + ",-1\t"s + document + "\r\n"s;
+			expected.AddDocument(document_id, document, DocumentStatus::BANNED, {document_id % 5, -1});
+		}
+	}
+	int fds[2];
+	ASSERT(pipe(fds) == 0);
+	thread writer([&input, fd = fds[1]] {
+		for (size_t pos = 0; pos < input.size();) {
+			const ssize_t written = write(fd, input.data() + pos, input.size() - pos);
+			if (written <= 0) {
+				break;
+			}
+			pos += written;
+		}
+		close(fd);
+	});
+	SearchServer search_server("and with of"s);
+	const size_t document_count = IngestDocuments(search_server, fds[0], 2);
+	writer.join();
+	close(fds[0]);
+	ASSERT_EQUAL(document_count, static_cast<size_t>(expected.GetDocumentCount()));
+	ASSERT_EQUAL(search_server.GetDocumentCount(), expected.GetDocumentCount());
+	for (const string& query : {"curly cat"s, "nasty -dog w5"s, "w13 tail"s}) {
+		ASSERT_EQUAL(search_server.FindTopDocuments(query, DocumentStatus::BANNED), expected.FindTopDocuments(query, DocumentStatus::BANNED));
+		ASSERT_EQUAL(search_server.FindTopDocuments(query), expected.FindTopDocuments(query));
+	}
+
+	// ошибка формата, пока вход ещё открыт: загрузка не должна ждать конца ввода
+	ASSERT(pipe(fds) == 0);
+	const string bad_line = "1\tFRESH\t\tcat\n"s;
+	ASSERT(write(fds[1], bad_line.data(), bad_line.size()) == static_cast<ssize_t>(bad_line.size()));
+	SearchServer bad_server(""s);
+	ASSERT_THROWS(IngestDocuments(bad_server, fds[0]), invalid_argument);
+	close(fds[0]);
+	close(fds[1]);
+}
+
+void TestQueryArena() {
+	QueryArena arena(64);
+	{
+		QueryArena::Scope outer(arena);
+		pmr::vector<int> numbers(outer.GetResource());
+		numbers.assign(1000, 7);
+		{
+			// вложенный запрос не сбрасывает арену внешнего
+			QueryArena::Scope inner(arena);
+			pmr::vector<int> more(inner.GetResource());
+			more.assign(10, 1);
+		}
+		ASSERT_EQUAL(numbers.size(), 1000u);
+		ASSERT(all_of(numbers.begin(), numbers.end(), [](int number) { return number == 7; }));
+		ASSERT_EQUAL(arena.GetBufferSize(), 64u);
+	}
+	// сброс увеличил буфер: теперь такой запрос помещается без кучи, и буфер больше не растёт
+	const size_t grown_size = arena.GetBufferSize();
+	ASSERT(grown_size >= 1000 * sizeof(int));
+	{
+		QueryArena::Scope scope(arena);
+		pmr::vector<int> numbers(1000, 7, scope.GetResource());
+	}
+	ASSERT_EQUAL(arena.GetBufferSize(), grown_size);
+
+	// запрос больше арены потока и повторный, уже без переполнения, дают одно и то же
+	SearchServer search_server = MakeTestServer();
+	string long_query = "curly -nasty"s;
+	for (int i = 0; i < 5000; ++i) {
+		long_query += " word"s + to_string(i);
+	}
+	const vector<Document> expected = search_server.FindTopDocuments("curly -nasty"s);
+	ASSERT_EQUAL(search_server.FindTopDocuments(long_query), expected);
+	ASSERT_EQUAL(search_server.FindTopDocuments(long_query), expected);
+	ASSERT_EQUAL(search_server.FindTopDocuments(execution::par, long_query), expected);
+}
+
+void TestStopWordSet() {
+	set<string, less<>> words;
+	for (int i = 0; i < 500; ++i) {
+		words.insert("stop"s + to_string(i * 7));
+	}
+	const StopWordSet stop_words(words);
+	ASSERT_EQUAL(stop_words.GetSize(), words.size());
+	for (int i = 0; i < 3500; ++i) {
+		const string word = "stop"s + to_string(i);
+		ASSERT_EQUAL(stop_words.Contains(word), words.count(word) > 0);
+	}
+	ASSERT(!stop_words.Contains(""s) && !stop_words.Contains("stop"s) && !stop_words.Contains("stop00"s));
+	vector<string_view> table_words = stop_words.GetWords();
+	sort(table_words.begin(), table_words.end());
+	ASSERT(equal(table_words.begin(), table_words.end(), words.begin(), words.end()));
+	ASSERT(!StopWordSet().Contains("and"s));
+
+	// таблица времени компиляции ведёт себя как стоп-слова из строки
+	static constexpr array<string_view, 3> STOP_WORDS = {"and"sv, "with"sv, "of"sv};
+	static constexpr StaticStopWordSet static_stop_words(STOP_WORDS);
+	static_assert(static_stop_words.Contains("with"sv) && !static_stop_words.Contains("cat"sv));
+	SearchServer static_server(static_stop_words);
+	const SearchServer expected = MakeTestServer();
+	for (size_t i = 0; i < TEST_DOCUMENTS.size(); ++i) {
+		static_server.AddDocument(i, TEST_DOCUMENTS[i], DocumentStatus::ACTUAL, {static_cast<int>(i), 1});
+	}
+	for (const string& query : {"cat and dog"s, "of"s, "big with eyes -nasty"s}) {
+		ASSERT_EQUAL(static_server.FindTopDocuments(query), expected.FindTopDocuments(query));
+	}
+	ASSERT_THROWS(StaticStopWordSet<2>({"and"sv, "and"sv}), invalid_argument);
+}
+
+void TestTokenizer() {
+	// длины вокруг границ 16-байтовых блоков, буквы обоих регистров, UTF-8 и повторные пробелы
+	mt19937 generator(7);
+	const string alphabet = "aZ  qM-+*\xd0\xba\xd0\x9a"s;
+	for (size_t length = 0; length < 70; ++length) {
+		string text;
+		for (size_t i = 0; i < length; ++i) {
+			text += alphabet[uniform_int_distribution<size_t>(0, alphabet.size() - 1)(generator)];
+		}
+		vector<string_view> words;
+		TokenizeWords(text, nullptr, words);
+		ASSERT_EQUAL(vector<string>(words.begin(), words.end()), SplitIntoWords(text));
+
+		string folded(text.size(), '\0');
+		vector<string_view> folded_words;
+		TokenizeWords(text, folded.data(), folded_words);
+		string expected = text;
+		for (char& c : expected) {
+			if (c >= 'A' && c <= 'Z') {
+				c = static_cast<char>(tolower(c));
+			}
+		}
+		ASSERT_EQUAL(folded, expected);
+		ASSERT_EQUAL(vector<string>(folded_words.begin(), folded_words.end()), SplitIntoWords(expected));
+		// в буфере на месте самого текста
+		FoldAsciiCase(text, text.data());
+		ASSERT_EQUAL(text, expected);
+	}
+	vector<string_view> words;
+	ASSERT_THROWS(TokenizeWords("seventeen bytes!! contr\x01l"s, nullptr, words), invalid_argument);
+
+	// приведение регистра совпадает с сервером, которому передали текст в нижнем регистре
+	SearchServer folding_server("And WITH of"s);
+	folding_server.SetAsciiCaseFolding(true);
+	const SearchServer expected = MakeTestServer();
+	for (size_t i = 0; i < TEST_DOCUMENTS.size(); ++i) {
+		string document = TEST_DOCUMENTS[i];
+		transform(document.begin(), document.end(), document.begin(), [](char c) {
+			return static_cast<char>(toupper(c));
+		});
+		folding_server.AddDocument(i, document, DocumentStatus::ACTUAL, {static_cast<int>(i), 1});
+	}
+	ASSERT_EQUAL(folding_server.FindTopDocuments("Curly CAT and"s), expected.FindTopDocuments("curly cat and"s));
+	ASSERT_EQUAL(folding_server.FindTopDocuments("BIG -Nasty"s), expected.FindTopDocuments("big -nasty"s));
+
+	// выключение возвращает стоп-слова в исходном регистре
+	SearchServer toggled_server("And with"s);
+	toggled_server.SetAsciiCaseFolding(true);
+	toggled_server.SetAsciiCaseFolding(false);
+	toggled_server.AddDocument(1, "and And with WITH"s, DocumentStatus::ACTUAL, {1});
+	const auto [matched_words, status] = toggled_server.MatchDocument("and And with WITH"s, 1);
+	ASSERT_EQUAL(vector<string>(matched_words.begin(), matched_words.end()), (vector<string>{"WITH"s, "and"s}));
+}
+
+void TestLazyPaginator() {
+	// страницы совпадают с Paginator, который строит их заранее
+	const SearchServer search_server = MakeTestServer();
+	const vector<Document> documents = search_server.FindTopDocuments("cat curly nasty big"s);
+	ASSERT_EQUAL(documents.size(), 5u);
+	const auto expected_pages = Paginate(documents, 2);
+	auto pages = PaginateLazy(documents, 2);
+	ASSERT_EQUAL(pages.size(), expected_pages.size());
+	size_t index = 0;
+	for (const auto page : pages) {
+		const auto expected_page = *next(expected_pages.begin(), index);
+		ASSERT_EQUAL(vector<Document>(page.begin(), page.end()), vector<Document>(expected_page.begin(), expected_page.end()));
+		ASSERT_EQUAL(vector<Document>(pages[index].begin(), pages[index].end()), vector<Document>(page.begin(), page.end()));
+		++index;
+	}
+	ASSERT_EQUAL(index, expected_pages.size());
+	ASSERT_EQUAL(pages[10].size(), 0u);
+	ASSERT_EQUAL(PaginateLazy(vector<int>{}, 3).size(), 0u);
+
+	// однопроходный поток: недочитанная страница пропускается при переходе к следующей
+	istringstream input("1 2 3 4 5 6 7"s);
+	LazyPaginator<istream_iterator<int>> stream_pages(istream_iterator<int>(input), istream_iterator<int>(), 3);
+	vector<vector<int>> read_pages;
+	for (const auto page : stream_pages) {
+		vector<int> values;
+		for (const int value : page) {
+			values.push_back(value);
+			if (values.size() == 2) {
+				break;
+			}
+		}
+		read_pages.push_back(values);
+	}
+	ASSERT_EQUAL(read_pages, (vector<vector<int>>{{1, 2}, {4, 5}, {7}}));
+
+	int next_value = 0;
+	auto generator = [&next_value]() -> optional<int> {
+		return next_value < 5 ? optional<int>(next_value++) : nullopt;
+	};
+	vector<vector<int>> generated_pages;
+	for (const auto page : PaginateGenerator(generator, 2)) {
+		generated_pages.emplace_back(page.begin(), page.end());
+	}
+	ASSERT_EQUAL(generated_pages, (vector<vector<int>>{{0, 1}, {2, 3}, {4}}));
+}
+
+// вывод ResultWriter через канал; данные укладываются в буфер канала
+template <typename WriteFunction>
+string WriteResults(ResultFormat format, WriteFunction write_function) {
+	int fds[2];
+	ASSERT(pipe(fds) == 0);
+	{
+		ResultWriter writer(fds[1], format);
+		write_function(writer);
+		writer.Flush();
+	}
+	close(fds[1]);
+	string output;
+	char buffer[4096];
+	for (ssize_t size = 0; (size = read(fds[0], buffer, sizeof(buffer))) > 0;) {
+		output.append(buffer, size);
+	}
+	close(fds[0]);
+	return output;
+}
+
+void TestResultWriter() {
+	const SearchServer search_server = MakeTestServer();
+	vector<Document> documents = search_server.FindTopDocuments("curly cat nasty big"s);
+	documents.push_back({7, 1234567.0, -3});
+	documents.push_back({8, 0.000012345678, 0});
+
+	// текст совпадает с operator<< для документов
+	ostringstream expected_text;
+	for (const Document& document : documents) {
+		expected_text << document << '\n';
+	}
+	ASSERT_EQUAL(WriteResults(ResultFormat::TEXT, [&](ResultWriter& writer) { writer.Write(documents); }), expected_text.str());
+
+	const vector<Document> read_documents = ReadBinaryDocuments(WriteResults(ResultFormat::BINARY, [&](ResultWriter& writer) {
+		writer.Write(documents);
+		writer.WriteMatch(1, {"curly"sv}, DocumentStatus::ACTUAL);
+	}));
+	ASSERT_EQUAL(read_documents.size(), documents.size());
+	for (size_t i = 0; i < documents.size(); ++i) {
+		ASSERT_EQUAL(read_documents[i].id, documents[i].id);
+		ASSERT_EQUAL(read_documents[i].relevance, documents[i].relevance);
+		ASSERT_EQUAL(read_documents[i].rating, documents[i].rating);
+	}
+	ASSERT_THROWS(ReadBinaryDocuments("SRESD\x01"s), invalid_argument);
+
+	// кавычки, обратная косая черта и управляющие символы экранируются
+	const string json = WriteResults(ResultFormat::JSON, [](ResultWriter& writer) {
+		writer.Write(Document{3, 0.5, 2});
+		writer.WriteMatch(3, {"a\"b"sv, "c\\d"sv, "e\x01\x1f\tf"sv}, DocumentStatus::BANNED);
+	});
+	ASSERT_EQUAL(json, "{\"document_id\":3,\"relevance\":0.5,\"rating\":2}\n"
+		"{\"document_id\":3,\"status\":\"BANNED\",\"words\":[\"a\\\"b\",\"c\\\\d\",\"e\\u0001\\u001f\\u0009f\"]}\n"s);
+}
+
+void TestRatingAggregation() {
+	// длины вокруг ширины SSE- и AVX2-блоков и крайние значения, которые переполнили бы int
+	mt19937 generator(11);
+	for (size_t count = 0; count < 40; ++count) {
+		vector<int> ratings(count);
+		for (int& rating : ratings) {
+			rating = uniform_int_distribution<int>(INT_MIN, INT_MAX)(generator);
+		}
+		if (count > 2) {
+			ratings[0] = INT_MAX;
+			ratings[1] = INT_MAX;
+			ratings[2] = INT_MIN;
+		}
+		const int64_t expected = accumulate(ratings.begin(), ratings.end(), int64_t{0});
+		ASSERT_EQUAL(SumRatings(ratings.data(), ratings.size()), expected);
+		ASSERT_EQUAL(AggregateRatings(ratings).sum, expected);
+		ASSERT_EQUAL(AggregateRatings(ratings).count, count);
+	}
+	vector<int> many_ratings(3 * PARALLEL_RATING_THRESHOLD + 5);
+	for (int& rating : many_ratings) {
+		rating = uniform_int_distribution<int>(INT_MIN, INT_MAX)(generator);
+	}
+	const int64_t expected = accumulate(many_ratings.begin(), many_ratings.end(), int64_t{0});
+	ASSERT_EQUAL(AggregateRatings(execution::seq, many_ratings).sum, expected);
+	ASSERT_EQUAL(AggregateRatings(execution::par, many_ratings).sum, expected);
+	ASSERT_EQUAL(AggregateRatings(execution::par, many_ratings).GetAverage(), static_cast<int>(expected / static_cast<int64_t>(many_ratings.size())));
+	ASSERT_EQUAL(RatingSum().GetAverage(), 0);
+
+	// оценки, досланные частями, дают тот же рейтинг, что и переданные сразу
+	SearchServer search_server(""s);
+	SearchServer expected_server(""s);
+	search_server.AddDocument(1, "curly cat"s, DocumentStatus::ACTUAL, {INT_MAX, 5});
+	search_server.AddRatings(1, {INT_MAX, -7, 3});
+	search_server.AddRatings(1, {});
+	expected_server.AddDocument(1, "curly cat"s, DocumentStatus::ACTUAL, {INT_MAX, 5, INT_MAX, -7, 3});
+	ASSERT_EQUAL(search_server.GetRatingSum(1).sum, expected_server.GetRatingSum(1).sum);
+	ASSERT_EQUAL(search_server.GetRatingSum(1).count, 5u);
+	ASSERT_EQUAL(search_server.FindTopDocuments("cat"s), expected_server.FindTopDocuments("cat"s));
+	ASSERT_THROWS(search_server.AddRatings(2, {1}), invalid_argument);
+}
+
+void TestUpdateDocument() {
+	// замены и смена статуса на месте совпадают с сервером, построенным заново из того же состояния
+	mt19937 generator(5);
+	const auto random_text = [&generator] {
+		string text;
+		for (int i = uniform_int_distribution<int>(0, 6)(generator); i > 0; --i) {
+			text += "w"s + to_string(uniform_int_distribution<int>(0, 15)(generator)) + " "s;
+		}
+		return text;
+	};
+	const int document_count = 50;
+	vector<string> texts(document_count);
+	vector<DocumentStatus> statuses(document_count, DocumentStatus::ACTUAL);
+	// рейтинги различны, чтобы порядок равных по релевантности документов был однозначным
+	vector<int> ratings(document_count);
+	SearchServer search_server("w0"s);
+	ShardedSearchServer sharded_server("w0"s, 3);
+	for (int document_id = 0; document_id < document_count; ++document_id) {
+		texts[document_id] = random_text();
+		ratings[document_id] = document_id;
+		search_server.AddDocument(document_id, texts[document_id], DocumentStatus::ACTUAL, {ratings[document_id]});
+		sharded_server.AddDocument(document_id, texts[document_id], DocumentStatus::ACTUAL, {ratings[document_id]});
+	}
+	const vector<string> queries = {"w1 w2 -w3"s, "w4 w5 w6 w7"s, "+w8 w9"s, "w10 w11 w12 w13 w14 w15"s};
+	for (int step = 1; step <= 300; ++step) {
+		const int document_id = uniform_int_distribution<int>(0, document_count - 1)(generator);
+		statuses[document_id] = step % 3 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+		if (step % 4 == 0) {
+			search_server.SetStatus(document_id, statuses[document_id]);
+			sharded_server.SetStatus(document_id, statuses[document_id]);
+		} else {
+			texts[document_id] = random_text();
+			ratings[document_id] = document_count + step;
+			search_server.UpdateDocument(document_id, texts[document_id], statuses[document_id], {ratings[document_id]});
+			sharded_server.UpdateDocument(document_id, texts[document_id], statuses[document_id], {ratings[document_id]});
+		}
+		if (step % 50 != 0) {
+			continue;
+		}
+		SearchServer expected("w0"s);
+		for (int id = 0; id < document_count; ++id) {
+			expected.AddDocument(id, texts[id], statuses[id], {ratings[id]});
+		}
+		for (const string& query : queries) {
+			for (const DocumentStatus status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED}) {
+				ASSERT_EQUAL(search_server.FindTopDocuments(query, status), expected.FindTopDocuments(query, status));
+				ASSERT_EQUAL(sharded_server.FindTopDocuments(query, status), expected.FindTopDocuments(query, status));
+			}
+		}
+		for (int id = 0; id < document_count; ++id) {
+			const auto [words, status] = search_server.MatchDocument("w1 w2 w3 w4 w5 w6 w7 w8"s, id);
+			const auto [expected_words, expected_status] = expected.MatchDocument("w1 w2 w3 w4 w5 w6 w7 w8"s, id);
+			ASSERT_EQUAL(words, expected_words);
+			ASSERT(status == expected_status);
+			ASSERT_EQUAL(search_server.GetWordFrequencies(id).size(), expected.GetWordFrequencies(id).size());
+		}
+	}
+	ASSERT_EQUAL(search_server.GetDocumentCount(), document_count);
+	ASSERT_THROWS(search_server.UpdateDocument(document_count, "w1"s, DocumentStatus::ACTUAL, {}), invalid_argument);
+	ASSERT_THROWS(search_server.SetStatus(-1, DocumentStatus::ACTUAL), invalid_argument);
+}
+
+} // namespace
+
+int main() {
+	TestRunner tr;
+	RUN_TEST(tr, TestPrefixExpansion);
+	RUN_TEST(tr, TestFuzzyExpansionRanking);
+	RUN_TEST(tr, TestSnapshotSearchServer);
+	RUN_TEST(tr, TestSegmentedSearchServer);
+	RUN_TEST(tr, TestGlobalExpansions);
+	RUN_TEST(tr, TestNumaShardPlacement);
+	RUN_TEST(tr, TestRemoveDuplicates);
+	RUN_TEST(tr, TestRemoveDocumentsBatch);
+	RUN_TEST(tr, TestWordFrequenciesIterator);
+	RUN_TEST(tr, TestRequestQueue);
+	RUN_TEST(tr, TestRequestQueueTimeWindowContention);
+	RUN_TEST(tr, TestRequestQueueSmallWindowContention);
+	RUN_TEST(tr, TestSearchMetrics);
+	RUN_TEST(tr, TestProfiler);
+	RUN_TEST(tr, TestQueryGrammar);
+	RUN_TEST(tr, TestOrdinalSet);
+	RUN_TEST(tr, TestPostingKernels);
+	RUN_TEST(tr, TestBulkIngest);
+	RUN_TEST(tr, TestQueryArena);
+	RUN_TEST(tr, TestStopWordSet);
+	RUN_TEST(tr, TestTokenizer);
+	RUN_TEST(tr, TestLazyPaginator);
+	RUN_TEST(tr, TestResultWriter);
+	RUN_TEST(tr, TestRatingAggregation);
+	RUN_TEST(tr, TestUpdateDocument);
+}